@@ -0,0 +1,52 @@
+/// checksum.h - digests of chip ranges and files: CRC-32 (as zlib, table in flash) and SHA-1
+
+#if !defined(CHECKSUM_H_)
+#define CHECKSUM_H_
+
+#include <stdint.h>
+
+const uint32_t CRC32_INIT = 0xFFFFFFFFUL;
+
+/// CRC-32 step; start with CRC32_INIT and invert the result
+uint32_t crc32_update(uint32_t crc, uint8_t data);
+
+struct sha1_context
+{
+    uint32_t h[5];
+    uint32_t length;        // bytes hashed so far
+    union {
+        uint8_t  block[64];
+        uint32_t w[16];     // the message schedule takes the place of the block it is made of
+    };
+};
+
+void sha1_begin(sha1_context &c);
+void sha1_update(sha1_context &c, uint8_t data);
+void sha1_end(sha1_context &c, uint8_t *digest);    // 20 bytes
+
+enum checksum_type {
+    CHECKSUM_CRC32,
+    CHECKSUM_SHA1
+};
+
+/// the state of the algorithm of type; callers that only need a CRC-32 keep a plain uint32_t
+/// with crc32_update() instead
+struct checksum
+{
+    uint8_t type;
+    union {
+        uint32_t crc;
+        sha1_context sha;
+    };
+};
+
+/// "crc32" or "sha1" (case does not matter); returns -1 for unknown names
+int8_t checksum_type_from_name(const char *name);
+
+void checksum_begin(checksum &c, uint8_t type);
+void checksum_update(checksum &c, uint8_t data);
+
+/// Writes the digest (big endian, as printed by crc32/sha1sum) and returns its length.
+uint8_t checksum_end(checksum &c, uint8_t *digest);
+
+#endif // CHECKSUM_H_
@@ -0,0 +1,74 @@
+/// command.h - text command input without heap allocation
+///
+/// Received characters are queued in a fixed ring of complete lines, so several commands can
+/// arrive while one is running. A line is split into tokens in place; the typed argument
+/// parsers consume one token each.
+
+#if !defined(COMMAND_H_)
+#define COMMAND_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+const uint8_t command_line_size = 64;       // longest command, including the terminating 0
+
+struct line_ring
+{
+    char    buf[128];
+    uint8_t head;           // next character to take out
+    uint8_t count;          // characters in the ring, including line terminators
+    uint8_t lines;          // complete lines in the ring
+    uint8_t partial;        // characters of the line still being received
+};
+
+/// Add a received character: '\n' ends a line, '\b' removes the last character of the
+/// current line, '\r' is ignored and characters beyond command_line_size are dropped.
+/// Returns false if the ring is full; the character is lost then, so callers should check
+/// line_ring_room() first. A '\n' still fits when line_ring_room() is false.
+bool line_ring_put(line_ring &r, char c);
+
+/// true while another character fits, keeping room for the terminator of the current line
+bool line_ring_room(const line_ring &r);
+
+/// Take the oldest complete line out of the ring; longer lines are cut to size - 1 characters.
+/// Returns false if there is no complete line.
+bool line_ring_get(line_ring &r, char *line, uint8_t size);
+
+/// Copy the newest complete line without taking it out; false if there is none.
+bool line_ring_last(const line_ring &r, char *line, uint8_t size);
+
+/// Remove the newest complete line, e.g. a command that does not wait for the ones before it.
+void line_ring_drop_last(line_ring &r);
+
+enum arg_result {
+    ARG_OK      =  0,
+    ARG_MISSING =  1,       // no more tokens, optional arguments take their default
+    ARG_BAD     = -1
+};
+
+struct tokenizer
+{
+    char *next;
+};
+
+void tokenizer_begin(tokenizer &t, char *line);
+
+/// Consume word, a PSTR, if the line continues with it as a whole token (case does not matter).
+bool token_word(tokenizer &t, PGM_P word);
+
+/// Next token, terminated in place; 0 at the end of the line.
+char *token_next(tokenizer &t);
+
+/// true if only blanks are left
+bool token_end(tokenizer &t);
+
+/// number: hex, or decimal after '#' (as the a command always took it)
+int8_t arg_number(tokenizer &t, uint32_t &value);
+
+/// length: a number > 0, optionally followed by k for units of 1024 bytes, e.g. 8k
+int8_t arg_length(tokenizer &t, uint32_t &value);
+
+/// file name in 8.3 form
+int8_t arg_filename(tokenizer &t, const char *&name);
+
+#endif // COMMAND_H_
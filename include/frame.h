@@ -0,0 +1,112 @@
+/// frame.h - binary framed serial protocol for bulk transfers
+///
+/// Every frame is
+///     0x7E | type | seq | len (2 bytes, LE) | payload (len bytes) | crc (2 bytes, LE)
+/// The CRC is CRC-16/XMODEM over type, seq, len and payload. There is no byte stuffing: the
+/// receiver resynchronizes on the next 0x7E after a timeout or CRC error.
+/// Frames from the host are answered with FRAME_ACK (same seq) or FRAME_NAK (payload: error
+/// code); data frames from the programmer are acknowledged the same way by the host.
+
+#if !defined(FRAME_H_)
+#define FRAME_H_
+
+#include <stdint.h>
+
+const uint8_t FRAME_SOF = 0x7E;
+
+enum frame_type {
+    FRAME_ACK   = 'A',
+    FRAME_NAK   = 'N',
+    FRAME_DATA  = 'D',      // programmer -> host: block of chip data
+    FRAME_PING  = 'P',      // host -> programmer: answered with ACK
+    FRAME_READ  = 'R',      // address (2 or 3), length (3): chip data as DATA frames
+    FRAME_BAUD  = 'B',      // baud rate (4): switch after ACK, confirmed by a PING at the new rate
+    FRAME_START = 'S',      // address (2 or 3), length (3): program the data of the following WRITE frames
+    FRAME_WRITE = 'W',      // host -> programmer: next block to program (seq counts from 0)
+    FRAME_PACKED = 'Z',     // host -> programmer: FRAME_WRITE with the block packed (unpack.h)
+    FRAME_END   = 'E',      // programmer -> host: result (1, frame_error) and bytes programmed (3)
+    FRAME_QUIT  = 'Q'       // back to the text console
+};
+
+enum frame_error {
+    FRAME_PENDING   =  1,   // frame_rx_feed(): frame not complete yet
+    FRAME_OK        =  0,
+    FRAME_TIMEOUT   = -1,
+    FRAME_BAD_CRC   = -2,
+    FRAME_TOO_LONG  = -3,
+    FRAME_BAD_ARGS  = -4,
+    FRAME_UNKNOWN   = -5,
+    FRAME_NO_ACK    = -6,
+    FRAME_PROGRAM_FAILED = -7,
+    FRAME_BAD_PACKING = -8  // a FRAME_PACKED block does not decode
+};
+
+struct frame_header
+{
+    uint8_t  type;
+    uint8_t  seq;
+    uint16_t len;
+};
+
+/// incremental receiver, lets a frame be assembled a byte at a time in the background
+struct frame_rx
+{
+    frame_header h;
+    uint8_t  state;
+    uint8_t *payload;
+    uint16_t max_len;
+    uint16_t pos;
+    uint16_t crc;
+    uint16_t received_crc;
+};
+
+/// (re)start reception of a frame into payload
+void frame_rx_begin(frame_rx &rx, uint8_t *payload, uint16_t max_len);
+
+/// Feed one received byte. Returns FRAME_PENDING until a frame is complete, then FRAME_OK or
+/// an error; after that the receiver waits for the next start of frame.
+int8_t frame_rx_feed(frame_rx &rx, uint8_t c);
+
+/// Feed all available bytes until a frame is complete or no byte arrived for timeout_ms.
+int8_t frame_rx_poll(frame_rx &rx, uint16_t timeout_ms);
+
+/// send a complete frame
+void frame_send(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len);
+
+/// incremental sender, hands a frame to the USART as its TX ring has room so the caller can
+/// do other work while the frame goes out
+struct frame_tx
+{
+    uint8_t  head[5];           // SOF, type, seq, len
+    uint8_t  crc[2];
+    const uint8_t *payload;
+    uint16_t len;
+    uint16_t pos;               // bytes of the frame queued so far
+};
+
+/// prepare a frame for frame_tx_pump(); payload has to stay unchanged until it is queued
+void frame_tx_begin(frame_tx &tx, uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len);
+
+/// Queue as much of the frame as the TX ring takes without waiting. Returns true when all of
+/// it is queued.
+bool frame_tx_pump(frame_tx &tx);
+
+/// queue the rest of the frame, waiting for room
+void frame_tx_finish(frame_tx &tx);
+
+/// send a NAK frame carrying an error code
+void frame_nak(uint8_t seq, int8_t error);
+
+/// Receive one frame. Waits up to timeout_ms for the start of the frame and for every
+/// following byte. Payloads longer than max_len are rejected with FRAME_TOO_LONG.
+/// Returns FRAME_OK or a negative frame_error.
+int8_t frame_receive(frame_header &h, uint8_t *payload, uint16_t max_len, uint16_t timeout_ms);
+
+/// Wait for the ACK of the frame seq just sent: FRAME_OK, or FRAME_NO_ACK after a NAK or
+/// a timeout.
+int8_t frame_wait_ack(uint8_t seq);
+
+/// Send a frame and wait for the matching ACK, retransmitting after a NAK or a timeout.
+int8_t frame_send_reliable(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len);
+
+#endif // FRAME_H_
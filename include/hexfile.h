@@ -0,0 +1,49 @@
+/// hexfile.h - streaming parser for Intel HEX and Motorola S-record files
+///
+/// Characters are fed one at a time, so a file can be parsed straight from SD blocks without
+/// holding a whole record in RAM. Data bytes are handed out as soon as they are decoded; the
+/// checksum of their record is only known when the record ends, so a caller that must not act
+/// on a bad record makes a validating pass over the file first.
+///
+/// Intel HEX: data (00), end of file (01), extended segment (02) and extended linear (04)
+/// address records; start address records (03, 05) are checked and ignored.
+/// S-records: S1/S2/S3 data, S7/S8/S9 termination; S0 headers and S5/S6 counts are ignored.
+
+#if !defined(HEXFILE_H_)
+#define HEXFILE_H_
+
+#include <stdint.h>
+
+enum hex_result {
+    HEX_PENDING     =  1,   // nothing to report yet
+    HEX_DATA        =  2,   // data byte in p.data for address p.address
+    HEX_RECORD      =  3,   // record complete, checksum ok
+    HEX_END         =  4,   // end of file or termination record, checksum ok
+    HEX_BAD_CHAR    = -1,
+    HEX_BAD_CHECKSUM = -2,
+    HEX_BAD_RECORD  = -3    // unknown record type or inconsistent length
+};
+
+struct hex_parser
+{
+    uint8_t  state;
+    uint8_t  srec;          // S-record (1) or Intel HEX (0)
+    uint8_t  type;          // record type, S-record type digit
+    uint8_t  addr_bytes;    // S-record: width of the address field
+    uint8_t  high;          // high nibble of the byte being decoded, 0xFF: none yet
+    uint8_t  sum;
+    uint16_t index;         // byte of the record being decoded
+    uint16_t length;        // bytes in the record (after ':' or the type digit)
+    uint32_t field;         // address field of the record
+    uint32_t base;          // Intel HEX: extended segment or linear address
+    uint32_t address;
+    uint8_t  data;
+    uint16_t line;          // line of the current record, counting from 1
+};
+
+void hex_begin(hex_parser &p);
+
+/// feed one character of the file; returns a hex_result
+int8_t hex_feed(hex_parser &p, char c);
+
+#endif // HEXFILE_H_
@@ -0,0 +1,24 @@
+/// unpack.h - decoder for the packed blocks of the binary mode (FRAME_PACKED)
+///
+/// A packed block is a sequence of tokens. Each token starts with a control byte c:
+///     0x00..0x7F  literal: the next c + 1 bytes are copied
+///     0x80..0xBF  match: (c & 0x3F) + 3 bytes are copied from d + 1 bytes back in the output,
+///                 d is the next byte; the copy may overlap its own output, so a distance of 1
+///                 repeats the last byte
+///     0xC0        0xFF run: n + 1 bytes of 0xFF, n is the next byte
+///     0xC1..0xFF  reserved
+/// Matches only reach back into the block being decoded. Every block decodes on its own, the
+/// output buffer is the whole window and the decoder keeps no state between calls.
+
+#if !defined(UNPACK_H_)
+#define UNPACK_H_
+
+#include <stdint.h>
+
+const int16_t UNPACK_BAD = -1;     // truncated block, reserved token or match before the start
+
+/// Decode the packed block in[0..in_len) into out, at most out_max bytes.
+/// Returns the number of bytes decoded or UNPACK_BAD.
+int16_t unpack_block(const uint8_t *in, uint16_t in_len, uint8_t *out, uint16_t out_max);
+
+#endif // UNPACK_H_
@@ -0,0 +1,38 @@
+/// usart.h - bulk transfers and XON/XOFF flow control on top of the core's HardwareSerial
+///
+/// The Arduino core's interrupt driven HardwareSerial drives USART0, but Serial and the two
+/// USART vectors are defined in usart.cpp in place of the core's HardwareSerial0.cpp. The ring
+/// sizes are build flags of the core (SERIAL_RX_BUFFER_SIZE, SERIAL_TX_BUFFER_SIZE in
+/// platformio.ini), 64 bytes each: the SD library and the block buffers leave no RAM for more.
+///
+/// RX: the core drops bytes while its ring is full. The RX vector calls back once the ring
+/// holds the high water mark, so the firmware can stop the sender with serial_send_now(XOFF)
+/// whatever it is busy with. The low water mark is polled with serial_poll_watermarks() where
+/// the firmware takes bytes out of the ring.
+/// TX: serial_write_some() queues what fits into the TX ring without waiting, so the caller
+/// can read the chip while earlier data goes out.
+
+#if !defined(USART_H_)
+#define USART_H_
+
+#include <Arduino.h>
+
+const uint8_t XON = 0x11;
+const uint8_t XOFF = 0x13;
+
+typedef void (*water_callback)();
+
+/// queue as much of buf as fits into the TX ring without waiting; returns the bytes taken
+uint16_t serial_write_some(const uint8_t *buf, uint16_t len);
+
+/// send c ahead of the bytes queued in the TX ring, waiting at most for one character; for
+/// XON/XOFF, which would come too late behind a full ring
+void serial_send_now(uint8_t c);
+
+/// on_high is called from the RX vector once the ring holds high bytes, on_low by
+/// serial_poll_watermarks() when it is back at low bytes; 0 turns on_high off
+void serial_set_watermarks(uint8_t high, uint8_t low, water_callback on_high, water_callback on_low);
+/// run on_low if the RX ring has drained to the low water mark
+void serial_poll_watermarks();
+
+#endif // USART_H_
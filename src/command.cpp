@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "command.h"
+
+static const uint8_t ring_size = sizeof(((line_ring *)0)->buf);
+
+static void ring_push(line_ring &r, char c)
+{
+    r.buf[(uint8_t)(r.head + r.count) % ring_size] = c;
+    r.count++;
+}
+
+bool line_ring_room(const line_ring &r)
+{
+    return r.count < ring_size - 1;
+}
+
+bool line_ring_put(line_ring &r, char c)
+{
+    switch ( c ) {
+        case '\r':
+            return true;
+        case '\b':
+            if ( r.partial ) {
+                r.partial--;
+                r.count--;
+            }
+            return true;
+        case '\n':
+            if ( r.count >= ring_size )
+                return false;
+            ring_push(r, 0);
+            r.partial = 0;
+            r.lines++;
+            return true;
+        default:
+            if ( r.partial >= command_line_size - 1 )
+                return true;        // cut, as line_ring_get() would
+            if ( !line_ring_room(r) )
+                return false;
+            ring_push(r, c);
+            r.partial++;
+            return true;
+    }
+}
+
+bool line_ring_get(line_ring &r, char *line, uint8_t size)
+{
+    uint8_t n = 0;
+    char c;
+
+    if ( !r.lines )
+        return false;
+    do {
+        c = r.buf[r.head];
+        r.head = (r.head + 1) % ring_size;
+        r.count--;
+        if ( n < size - 1 )
+            line[n++] = c;
+    } while ( c );
+    line[n] = 0;
+    r.lines--;
+    return true;
+}
+
+// offset from head and length of the newest complete line
+static bool last_line(const line_ring &r, uint8_t &start, uint8_t &len)
+{
+    uint8_t end;
+
+    if ( !r.lines )
+        return false;
+    end = r.count - r.partial - 1;      // its terminator
+    start = end;
+    while ( start && r.buf[(uint8_t)(r.head + start - 1) % ring_size] )
+        start--;
+    len = end - start;
+    return true;
+}
+
+bool line_ring_last(const line_ring &r, char *line, uint8_t size)
+{
+    uint8_t start, len, n;
+
+    if ( !last_line(r, start, len) )
+        return false;
+    for ( n = 0; n < len && n < size - 1; n++ )
+        line[n] = r.buf[(uint8_t)(r.head + start + n) % ring_size];
+    line[n] = 0;
+    return true;
+}
+
+void line_ring_drop_last(line_ring &r)
+{
+    uint8_t start, len;
+
+    if ( !last_line(r, start, len) )
+        return;
+    // the line still being received moves down over it
+    for ( uint8_t i = 0; i < r.partial; i++ )
+        r.buf[(uint8_t)(r.head + start + i) % ring_size] =
+            r.buf[(uint8_t)(r.head + start + len + 1 + i) % ring_size];
+    r.count -= len + 1;
+    r.lines--;
+}
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+void tokenizer_begin(tokenizer &t, char *line)
+{
+    t.next = line;
+}
+
+bool token_word(tokenizer &t, PGM_P word)
+{
+    char *p = t.next;
+    char c;
+
+    while ( is_blank(*p) )
+        p++;
+    while ( (c = pgm_read_byte(word++)) )
+        if ( tolower(*p++) != c )
+            return false;
+    if ( *p && !is_blank(*p) )
+        return false;
+    t.next = p;
+    return true;
+}
+
+char *token_next(tokenizer &t)
+{
+    char *start;
+
+    while ( is_blank(*t.next) )
+        t.next++;
+    if ( !*t.next )
+        return 0;
+    start = t.next;
+    while ( *t.next && !is_blank(*t.next) )
+        t.next++;
+    if ( *t.next )
+        *t.next++ = 0;
+    return start;
+}
+
+bool token_end(tokenizer &t)
+{
+    while ( is_blank(*t.next) )
+        t.next++;
+    return !*t.next;
+}
+
+int8_t arg_number(tokenizer &t, uint32_t &value)
+{
+    char *end, *s = token_next(t);
+
+    if ( !s )
+        return ARG_MISSING;
+    if ( *s == '#' )
+        value = strtoul(++s, &end, 10);
+    else
+        value = strtoul(s, &end, 16);
+    return end != s && !*end ? ARG_OK : ARG_BAD;
+}
+
+int8_t arg_length(tokenizer &t, uint32_t &value)
+{
+    char *end, *s = token_next(t);
+
+    if ( !s )
+        return ARG_MISSING;
+    if ( *s == '#' )
+        value = strtoul(++s, &end, 10);
+    else {
+        end = s + strlen(s) - 1;
+        if ( end > s && (*end == 'k' || *end == 'K') ) {
+            *end = 0;
+            value = strtoul(s, &end, 10) * 1024;
+        }
+        else
+            value = strtoul(s, &end, 16);
+    }
+    return end != s && !*end && value ? ARG_OK : ARG_BAD;
+}
+
+int8_t arg_filename(tokenizer &t, const char *&name)
+{
+    char *s = token_next(t), *dot;
+
+    if ( !s )
+        return ARG_MISSING;
+    dot = strchr(s, '.');
+    if ( dot ? dot - s > 8 || strlen(dot + 1) > 3 : strlen(s) > 8 )
+        return ARG_BAD;
+    name = s;
+    return ARG_OK;
+}
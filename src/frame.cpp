@@ -0,0 +1,217 @@
+#include <Arduino.h>
+#include <util/crc16.h>
+
+#include "frame.h"
+#include "usart.h"
+
+const uint16_t frame_ack_timeout_ms = 200;
+const uint8_t  frame_max_retries = 5;
+
+static uint16_t frame_crc;
+
+static void frame_put(uint8_t b)
+{
+    frame_crc = _crc_xmodem_update(frame_crc, b);
+    Serial.write(b);
+}
+
+void frame_send(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    uint16_t crc;
+
+    Serial.write(FRAME_SOF);
+    frame_crc = 0;
+    frame_put(type);
+    frame_put(seq);
+    frame_put(len & 0xFF);
+    frame_put(len >> 8);
+    while ( len-- )
+        frame_put(*payload++);
+    crc = frame_crc;
+    Serial.write(crc & 0xFF);
+    Serial.write(crc >> 8);
+}
+
+void frame_tx_begin(frame_tx &tx, uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    uint16_t crc = 0;
+
+    tx.head[0] = FRAME_SOF;
+    tx.head[1] = type;
+    tx.head[2] = seq;
+    tx.head[3] = len & 0xFF;
+    tx.head[4] = len >> 8;
+    for ( uint8_t i = 1; i < sizeof(tx.head); i++ )
+        crc = _crc_xmodem_update(crc, tx.head[i]);
+    for ( uint16_t i = 0; i < len; i++ )
+        crc = _crc_xmodem_update(crc, payload[i]);
+    tx.crc[0] = crc & 0xFF;
+    tx.crc[1] = crc >> 8;
+    tx.payload = payload;
+    tx.len = len;
+    tx.pos = 0;
+}
+
+// the part of the frame at tx.pos that is contiguous in memory
+static const uint8_t *frame_tx_part(const frame_tx &tx, uint16_t &n)
+{
+    uint16_t pos = tx.pos;
+
+    if ( pos < sizeof(tx.head) ) {
+        n = sizeof(tx.head) - pos;
+        return tx.head + pos;
+    }
+    pos -= sizeof(tx.head);
+    if ( pos < tx.len ) {
+        n = tx.len - pos;
+        return tx.payload + pos;
+    }
+    pos -= tx.len;
+    n = sizeof(tx.crc) - pos;
+    return tx.crc + pos;
+}
+
+bool frame_tx_pump(frame_tx &tx)
+{
+    const uint16_t size = sizeof(tx.head) + tx.len + sizeof(tx.crc);
+    uint16_t n, queued;
+
+    while ( tx.pos < size ) {
+        const uint8_t *part = frame_tx_part(tx, n);
+        tx.pos += queued = serial_write_some(part, n);
+        if ( queued < n )
+            return false;
+    }
+    return true;
+}
+
+void frame_tx_finish(frame_tx &tx)
+{
+    const uint16_t size = sizeof(tx.head) + tx.len + sizeof(tx.crc);
+    uint16_t n;
+
+    while ( tx.pos < size ) {
+        const uint8_t *part = frame_tx_part(tx, n);
+        Serial.write(part, n);
+        tx.pos += n;
+    }
+}
+
+void frame_nak(uint8_t seq, int8_t error)
+{
+    uint8_t code = (uint8_t)error;
+    frame_send(FRAME_NAK, seq, &code, 1);
+}
+
+enum frame_rx_state {
+    RX_SOF, RX_TYPE, RX_SEQ, RX_LEN_LO, RX_LEN_HI, RX_PAYLOAD, RX_CRC_LO, RX_CRC_HI
+};
+
+void frame_rx_begin(frame_rx &rx, uint8_t *payload, uint16_t max_len)
+{
+    rx.state = RX_SOF;
+    rx.payload = payload;
+    rx.max_len = max_len;
+}
+
+int8_t frame_rx_feed(frame_rx &rx, uint8_t c)
+{
+    switch ( rx.state ) {
+        case RX_SOF:
+            if ( c == FRAME_SOF ) {
+                rx.crc = 0;
+                rx.state = RX_TYPE;
+            }
+            return FRAME_PENDING;
+        case RX_PAYLOAD:
+            rx.payload[rx.pos++] = c;
+            rx.crc = _crc_xmodem_update(rx.crc, c);
+            if ( rx.pos == rx.h.len )
+                rx.state = RX_CRC_LO;
+            return FRAME_PENDING;
+        case RX_CRC_LO:
+            rx.received_crc = c;
+            rx.state = RX_CRC_HI;
+            return FRAME_PENDING;
+        case RX_CRC_HI:
+            rx.state = RX_SOF;
+            return (rx.received_crc | (c << 8)) == rx.crc ? FRAME_OK : FRAME_BAD_CRC;
+        default:
+            break;
+    }
+    rx.crc = _crc_xmodem_update(rx.crc, c);
+    switch ( rx.state ) {
+        case RX_TYPE:
+            rx.h.type = c;
+            rx.state = RX_SEQ;
+            break;
+        case RX_SEQ:
+            rx.h.seq = c;
+            rx.state = RX_LEN_LO;
+            break;
+        case RX_LEN_LO:
+            rx.h.len = c;
+            rx.state = RX_LEN_HI;
+            break;
+        case RX_LEN_HI:
+            rx.h.len |= c << 8;
+            rx.pos = 0;
+            if ( rx.h.len > rx.max_len ) {
+                rx.state = RX_SOF;
+                return FRAME_TOO_LONG;
+            }
+            rx.state = rx.h.len ? RX_PAYLOAD : RX_CRC_LO;
+            break;
+    }
+    return FRAME_PENDING;
+}
+
+int8_t frame_rx_poll(frame_rx &rx, uint16_t timeout_ms)
+{
+    unsigned long start = millis();
+    int8_t rc;
+
+    for ( ;; ) {
+        while ( Serial.available() ) {
+            if ( (rc = frame_rx_feed(rx, Serial.read())) != FRAME_PENDING )
+                return rc;
+            start = millis();
+        }
+        if ( millis() - start >= timeout_ms ) {
+            rx.state = RX_SOF;
+            return FRAME_TIMEOUT;
+        }
+    }
+}
+
+int8_t frame_receive(frame_header &h, uint8_t *payload, uint16_t max_len, uint16_t timeout_ms)
+{
+    frame_rx rx;
+    int8_t rc;
+
+    frame_rx_begin(rx, payload, max_len);
+    rc = frame_rx_poll(rx, timeout_ms);
+    h = rx.h;
+    return rc;
+}
+
+int8_t frame_wait_ack(uint8_t seq)
+{
+    frame_header reply;
+    uint8_t code;
+
+    if ( frame_receive(reply, &code, sizeof(code), frame_ack_timeout_ms) == FRAME_OK
+         && reply.type == FRAME_ACK && reply.seq == seq )
+        return FRAME_OK;
+    return FRAME_NO_ACK;
+}
+
+int8_t frame_send_reliable(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    for ( uint8_t attempt = 0; attempt < frame_max_retries; attempt++ ) {
+        frame_send(type, seq, payload, len);
+        if ( frame_wait_ack(seq) == FRAME_OK )
+            return FRAME_OK;
+    }
+    return FRAME_NO_ACK;
+}
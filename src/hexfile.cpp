@@ -0,0 +1,154 @@
+#include <stdint.h>
+
+#include "hexfile.h"
+
+enum hex_state {
+    HEX_IDLE,               // between records
+    HEX_SREC_TYPE,          // 'S' seen, type digit next
+    HEX_BYTES               // hex pairs of the record
+};
+
+static int8_t hex_digit(char c)
+{
+    if ( c >= '0' && c <= '9' )
+        return c - '0';
+    if ( c >= 'A' && c <= 'F' )
+        return c - 'A' + 10;
+    if ( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+    return -1;
+}
+
+static void hex_record_start(hex_parser &p)
+{
+    p.state = HEX_BYTES;
+    p.high = 0xFF;
+    p.sum = 0;
+    p.index = 0;
+    p.length = 0xFFFF;      // set by the length byte
+    p.field = 0;
+}
+
+// ':' LL AAAA TT DD... CC, the sum of all bytes is 0
+static int8_t intel_byte(hex_parser &p, uint16_t i, uint8_t b)
+{
+    if ( i == 0 ) {
+        p.length = b + 5;
+        return HEX_PENDING;
+    }
+    if ( i == p.length - 1 ) {
+        p.state = HEX_IDLE;
+        if ( p.sum != 0 )
+            return HEX_BAD_CHECKSUM;
+        if ( p.type == 0x02 )
+            p.base = (p.field & 0xFFFF) << 4;
+        else if ( p.type == 0x04 )
+            p.base = (p.field & 0xFFFF) << 16;
+        return p.type == 0x01 ? HEX_END : HEX_RECORD;
+    }
+    if ( i == 3 ) {
+        p.type = b;
+        uint8_t n = p.length - 5;
+        if ( p.type > 0x05 || (p.type == 0x01 && n != 0)
+             || ((p.type == 0x02 || p.type == 0x04) && n != 2)
+             || ((p.type == 0x03 || p.type == 0x05) && n != 4) ) {
+            p.state = HEX_IDLE;
+            return HEX_BAD_RECORD;
+        }
+        return HEX_PENDING;
+    }
+    if ( i < 3 || p.type != 0x00 ) {
+        p.field = (p.field << 8) | b;   // record address, then the value of address records
+        return HEX_PENDING;
+    }
+    p.address = p.base + p.field + (i - 4);
+    p.data = b;
+    return HEX_DATA;
+}
+
+// 'S' T CC AA.. DD... KK, the sum of all bytes is 0xFF
+static int8_t srec_byte(hex_parser &p, uint16_t i, uint8_t b)
+{
+    if ( i == 0 ) {
+        p.length = b + 1;
+        if ( b < p.addr_bytes + 1 ) {
+            p.state = HEX_IDLE;
+            return HEX_BAD_RECORD;
+        }
+        return HEX_PENDING;
+    }
+    if ( i == p.length - 1 ) {
+        p.state = HEX_IDLE;
+        if ( p.sum != 0xFF )
+            return HEX_BAD_CHECKSUM;
+        return p.type >= 7 ? HEX_END : HEX_RECORD;
+    }
+    if ( i <= p.addr_bytes ) {
+        p.field = (p.field << 8) | b;
+        return HEX_PENDING;
+    }
+    if ( p.type < 1 || p.type > 3 )
+        return HEX_PENDING;
+    p.address = p.field + (i - p.addr_bytes - 1);
+    p.data = b;
+    return HEX_DATA;
+}
+
+void hex_begin(hex_parser &p)
+{
+    p.state = HEX_IDLE;
+    p.base = 0;
+    p.line = 1;
+}
+
+int8_t hex_feed(hex_parser &p, char c)
+{
+    int8_t v;
+
+    switch ( p.state ) {
+        case HEX_IDLE:
+            if ( c == ':' ) {
+                p.srec = 0;
+                hex_record_start(p);
+            }
+            else if ( c == 'S' || c == 's' )
+                p.state = HEX_SREC_TYPE;
+            else if ( c == '\n' )
+                p.line++;
+            else if ( c != '\r' && c != ' ' && c != '\t' && c != 0x1A )   // 0x1A: DOS end of file
+                return HEX_BAD_CHAR;
+            return HEX_PENDING;
+        case HEX_SREC_TYPE:
+            p.type = c - '0';
+            switch ( p.type ) {
+                case 0: case 1: case 5: case 9:
+                    p.addr_bytes = 2;
+                    break;
+                case 2: case 6: case 8:
+                    p.addr_bytes = 3;
+                    break;
+                case 3: case 7:
+                    p.addr_bytes = 4;
+                    break;
+                default:
+                    p.state = HEX_IDLE;
+                    return HEX_BAD_RECORD;
+            }
+            p.srec = 1;
+            hex_record_start(p);
+            return HEX_PENDING;
+    }
+    if ( (v = hex_digit(c)) < 0 ) {
+        p.state = HEX_IDLE;
+        return HEX_BAD_CHAR;
+    }
+    if ( p.high == 0xFF ) {
+        p.high = v;
+        return HEX_PENDING;
+    }
+    uint8_t b = (p.high << 4) | v;
+    p.high = 0xFF;
+    p.sum += b;
+    uint16_t i = p.index++;
+    return p.srec ? srec_byte(p, i, b) : intel_byte(p, i, b);
+}
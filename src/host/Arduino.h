@@ -0,0 +1,162 @@
+/// Arduino.h replacement for the host build (env:native).
+/// Provides the subset of the Arduino core the firmware uses. Timing functions run on the
+/// simulated clock in sim.h. Serial is the core's interrupt driven HardwareSerial, running on
+/// the simulated USART0 (stdin/stdout).
+
+#if !defined(HOST_ARDUINO_H_)
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+#define HEX 16
+#define DEC 10
+#define OCT 8
+#define BIN 2
+
+#define F_CPU 16000000UL
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+#define SS   10
+#define MOSI 11
+#define MISO 12
+#define SCK  13
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String
+{
+public:
+    String(const char *s = "");
+    String(const String &other);
+    ~String();
+    String &operator=(const String &other);
+    String &operator=(const char *s);
+    String &operator+=(char c);
+    String &operator+=(const char *s);
+
+    unsigned char reserve(unsigned int size);
+    unsigned int length() const { return len_; }
+    const char *c_str() const { return buf_; }
+    char operator[](unsigned int index) const { return index < len_ ? buf_[index] : 0; }
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void trim();
+    long toInt() const { return atol(buf_); }
+
+private:
+    void assign(const char *s, unsigned int len);
+    char *buf_;
+    unsigned int len_;
+    unsigned int capacity_;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len);
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+    size_t print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+
+private:
+    size_t printNumber(unsigned long n, uint8_t base);
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+
+protected:
+    Stream() : timeout_(1000) {}
+    unsigned long timeout_;
+};
+
+// ring sizes of HardwareSerial, set with build flags as for the AVR core
+#if !defined(SERIAL_RX_BUFFER_SIZE)
+#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+#if !defined(SERIAL_TX_BUFFER_SIZE)
+#define SERIAL_TX_BUFFER_SIZE 64
+#endif
+
+/// The AVR core's driver for USART0, on the simulated registers: the receive interrupt puts
+/// bytes into the RX ring and drops them while it is full, write() queues into the TX ring
+/// (waiting while it is full) and the data register empty interrupt drains it.
+class HardwareSerial : public Stream
+{
+public:
+    // as in the core; the host class always runs the simulated USART0
+    HardwareSerial(sim::io_register *ubrrh, sim::io_register *ubrrl, sim::io_register *ucsra,
+                   sim::io_register *ucsrb, sim::io_register *ucsrc, sim::io_register *udr);
+    void begin(unsigned long baud);
+    void end();
+    int available();
+    int peek();
+    int read();
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t c);
+    using Print::write;
+    operator bool() { return true; }
+
+    // interrupt handlers, called from the ISRs in usart.cpp
+    void _rx_complete_irq();
+    void _tx_udr_empty_irq();
+
+private:
+    volatile uint8_t rx_head_, rx_tail_;
+    volatile uint8_t tx_head_, tx_tail_;
+    bool    written_;           // flush() has something to wait for
+    uint8_t rx_[SERIAL_RX_BUFFER_SIZE];
+    uint8_t tx_[SERIAL_TX_BUFFER_SIZE];
+};
+
+extern HardwareSerial Serial;
+
+void setup();
+void loop();
+void serialEvent();
+
+#endif // HOST_ARDUINO_H_
@@ -0,0 +1,9 @@
+/// HardwareSerial_private.h replacement for the host build: the core keeps the receive
+/// interrupt handler here, the host defines all of HardwareSerial in arduino_host.cpp.
+
+#if !defined(HOST_HARDWARESERIAL_PRIVATE_H_)
+#define HOST_HARDWARESERIAL_PRIVATE_H_
+
+#include <Arduino.h>
+
+#endif // HOST_HARDWARESERIAL_PRIVATE_H_
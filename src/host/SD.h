@@ -0,0 +1,74 @@
+/// SD.h replacement for the host build. Files live in a directory on the host (default "sd",
+/// see --sd). Like the SD library on the Nano there is a single 512 byte block cache for the
+/// whole volume; every access to a block that is not cached costs simulated SPI time.
+
+#if !defined(HOST_SD_H_)
+#define HOST_SD_H_
+
+#include <Arduino.h>
+
+#define O_READ   0x01
+#define O_RDONLY O_READ
+#define O_WRITE  0x02
+#define O_WRONLY O_WRITE
+#define O_RDWR   (O_READ | O_WRITE)
+#define O_APPEND 0x04
+#define O_CREAT  0x10
+#define O_TRUNC  0x40
+
+#define FILE_READ  O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+namespace sim
+{
+    struct sd_file;
+
+    /// simulated duration of one block transfer between card and cache
+    const uint32_t sd_block_read_us  = 1100;
+    const uint32_t sd_block_write_us = 1600;
+
+    extern const char *sd_root;
+}
+
+class File : public Stream
+{
+public:
+    File() : file_(0) {}
+    File(sim::sd_file *f);
+    File(const File &other);
+    File &operator=(const File &other);
+    ~File();
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buf, size_t size);
+    using Print::write;
+    int read();
+    int peek();
+    int available();
+    void flush();
+    int read(void *buf, uint16_t nbyte);
+    bool seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void close();
+    operator bool() { return file_ != 0; }
+    const char *name();
+    bool isDirectory() { return false; }
+
+private:
+    sim::sd_file *file_;
+};
+
+class SDClass
+{
+public:
+    bool begin(uint8_t csPin = SS);
+    File open(const char *filename, uint8_t mode = FILE_READ);
+    bool exists(const char *filepath);
+    bool remove(const char *filepath);
+    bool mkdir(const char *filepath);
+};
+
+extern SDClass SD;
+
+#endif // HOST_SD_H_
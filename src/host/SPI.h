@@ -0,0 +1,71 @@
+/// SPI.h replacement for the host build. Transfers go through the simulated SPDR/SPSR, so
+/// they cost the same SPI clock cycles and reach the 595 address latch like on the Nano.
+
+#if !defined(HOST_SPI_H_)
+#define HOST_SPI_H_
+
+#include <Arduino.h>
+
+#define SPI_CLOCK_DIV4   0x00
+#define SPI_CLOCK_DIV16  0x01
+#define SPI_CLOCK_DIV64  0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2   0x04
+#define SPI_CLOCK_DIV8   0x05
+#define SPI_CLOCK_DIV32  0x06
+
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+class SPISettings
+{
+public:
+    SPISettings() : clock_(4000000UL) {}
+    SPISettings(uint32_t clock, uint8_t, uint8_t) : clock_(clock) {}
+    uint32_t clock_;
+};
+
+class SPIClass
+{
+public:
+    void begin()
+    {
+        DDRB |= _BV(PB2) | _BV(PB3) | _BV(PB5);
+        SPCR = _BV(MSTR) | _BV(SPE);
+    }
+    void end() { SPCR = 0; }
+    void beginTransaction(const SPISettings &settings);
+    void endTransaction() {}
+    void setClockDivider(uint8_t div)
+    {
+        SPCR = (SPCR & ~0x03) | (div & 0x03);
+        SPSR = (div & 0x04) ? _BV(SPI2X) : 0;
+    }
+
+    uint8_t transfer(uint8_t data)
+    {
+        SPDR = data;
+        while (!(SPSR & _BV(SPIF)))
+            ;
+        return SPDR;
+    }
+
+    uint16_t transfer16(uint16_t data)
+    {
+        uint16_t in = transfer(data >> 8) << 8;
+        return in | transfer(data & 0xFF);
+    }
+
+    void transfer(void *buf, size_t count)
+    {
+        uint8_t *p = (uint8_t *)buf;
+        while (count--) {
+            *p = transfer(*p);
+            p++;
+        }
+    }
+};
+
+extern SPIClass SPI;
+
+#endif // HOST_SPI_H_
@@ -0,0 +1,826 @@
+/// Host implementation of the Arduino core subset, SPI and SD, plus main() for env:native.
+///
+/// usage: firmware [--sd DIR] [--chip-type w27c512|at28c256|at27c040] [--chip-in FILE] [--chip-out FILE]
+///                 [--program-us N] [--write-us N] [--access-ns N] [--gang N [--socket K ...]] [--xonxoff]
+///                 [--profile]
+///
+/// --gang N puts N W27C512 on the gang board instead of the single chip. --socket K makes the
+/// following --chip-in and --program-us apply to socket K only; --chip-out writes socket K to
+/// FILE.K. --xonxoff makes the sending side obey XOFF/XON from the firmware (flow xon).
+/// Commands are read from stdin exactly as typed into the serial monitor. After stdin is
+/// exhausted and the firmware is idle, the simulated counters are printed to stderr.
+
+#if defined(EEPROGRAMMER_HOST)
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+
+#include <ctype.h>
+#include <sys/stat.h>
+#include <string>
+
+#include "sim.h"
+
+SPIClass SPI;
+SDClass SD;
+
+// ----------------------------------------------------------------------------------------
+// timing
+
+unsigned long millis()
+{
+    sim::advance(20);
+    sim::serial_idle_poll();
+    return (unsigned long)(sim::now_us() / 1000);
+}
+
+unsigned long micros()
+{
+    sim::advance(20);
+    return (unsigned long)sim::now_us();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    sim::stats.delay_us += us;
+    sim::advance_us(us);
+}
+
+void delay(unsigned long ms)
+{
+    sim::stats.delay_us += ms * 1000UL;
+    sim::advance_us(ms * 1000UL);
+}
+
+// ----------------------------------------------------------------------------------------
+// String
+
+String::String(const char *s) : buf_(0), len_(0), capacity_(0) { assign(s, strlen(s)); }
+String::String(const String &other) : buf_(0), len_(0), capacity_(0) { assign(other.buf_, other.len_); }
+String::~String() { free(buf_); }
+String &String::operator=(const String &other) { if (this != &other) assign(other.buf_, other.len_); return *this; }
+String &String::operator=(const char *s) { assign(s, strlen(s)); return *this; }
+
+void String::assign(const char *s, unsigned int len)
+{
+    reserve(len);
+    memmove(buf_, s, len);
+    buf_[len] = 0;
+    len_ = len;
+}
+
+unsigned char String::reserve(unsigned int size)
+{
+    if (buf_ && capacity_ >= size)
+        return 1;
+    char *p = (char *)realloc(buf_, size + 1);
+    if (!p)
+        return 0;
+    if (!buf_)
+        p[0] = 0;
+    buf_ = p;
+    capacity_ = size;
+    return 1;
+}
+
+String &String::operator+=(char c)
+{
+    reserve(len_ + 1);
+    buf_[len_++] = c;
+    buf_[len_] = 0;
+    return *this;
+}
+
+String &String::operator+=(const char *s)
+{
+    while (*s)
+        *this += *s++;
+    return *this;
+}
+
+String String::substring(unsigned int from) const
+{
+    return substring(from, len_);
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    String result;
+    if (to > len_)
+        to = len_;
+    if (from < to)
+        result.assign(buf_ + from, to - from);
+    return result;
+}
+
+void String::remove(unsigned int index)
+{
+    remove(index, len_);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index >= len_)
+        return;
+    if (count > len_ - index)
+        count = len_ - index;
+    memmove(buf_ + index, buf_ + index + count, len_ - index - count + 1);
+    len_ -= count;
+}
+
+void String::trim()
+{
+    unsigned int begin = 0;
+    while (begin < len_ && isspace((unsigned char)buf_[begin]))
+        begin++;
+    unsigned int end = len_;
+    while (end > begin && isspace((unsigned char)buf_[end - 1]))
+        end--;
+    memmove(buf_, buf_ + begin, end - begin);
+    len_ = end - begin;
+    buf_[len_] = 0;
+}
+
+// ----------------------------------------------------------------------------------------
+// Print / Stream
+
+size_t Print::write(const uint8_t *buf, size_t len)
+{
+    size_t n = 0;
+    while (len--)
+        n += write(*buf++);
+    return n;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2)
+        base = 10;
+    do {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+size_t Print::print(long n, int base)
+{
+    if (base == 10 && n < 0)
+        return print('-') + printNumber(-n, 10);
+    return printNumber((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length) {
+        int c = read();
+        if (c < 0)
+            break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+// ----------------------------------------------------------------------------------------
+// HardwareSerial on the simulated USART0, as in the AVR core (HardwareSerial.cpp). Serial and
+// the ISRs are in usart.cpp, as on the Nano.
+
+HardwareSerial::HardwareSerial(sim::io_register *, sim::io_register *, sim::io_register *,
+                               sim::io_register *, sim::io_register *, sim::io_register *)
+    : rx_head_(0), rx_tail_(0), tx_head_(0), tx_tail_(0), written_(false)
+{
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    uint16_t ubrr = (F_CPU / 4 / baud - 1) / 2;    // double speed mode, rounded
+
+    UCSR0A = _BV(U2X0);
+    UBRR0H = ubrr >> 8;
+    UBRR0L = ubrr & 0xFF;
+    written_ = false;
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);             // 8N1
+    UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+}
+
+void HardwareSerial::end()
+{
+    flush();
+    UCSR0B = 0;
+    rx_head_ = rx_tail_;
+}
+
+int HardwareSerial::available()
+{
+    return (SERIAL_RX_BUFFER_SIZE + rx_head_ - rx_tail_) % SERIAL_RX_BUFFER_SIZE;
+}
+
+int HardwareSerial::peek()
+{
+    return rx_head_ == rx_tail_ ? -1 : rx_[rx_tail_];
+}
+
+int HardwareSerial::read()
+{
+    if (rx_head_ == rx_tail_)
+        return -1;
+    uint8_t c = rx_[rx_tail_];
+    rx_tail_ = (rx_tail_ + 1) % SERIAL_RX_BUFFER_SIZE;
+    return c;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    uint8_t head = tx_head_, tail = tx_tail_;
+    return head >= tail ? SERIAL_TX_BUFFER_SIZE - 1 - head + tail : tail - head - 1;
+}
+
+void HardwareSerial::flush()
+{
+    if (!written_)
+        return;
+    // until the ring is empty and the last byte has left the shift register
+    while ((UCSR0B & _BV(UDRIE0)) || !(UCSR0A & _BV(TXC0)))
+        if (!(SREG & _BV(SREG_I)) && (UCSR0B & _BV(UDRIE0)) && (UCSR0A & _BV(UDRE0)))
+            _tx_udr_empty_irq();
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    sim::advance(40);       // bookkeeping of the core's write()
+    written_ = true;
+    // an idle transmitter takes the byte right away
+    if (tx_head_ == tx_tail_ && (UCSR0A & _BV(UDRE0))) {
+        uint8_t sreg = SREG;
+        cli();
+        UDR0 = c;
+        UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0);
+        SREG = sreg;
+        return 1;
+    }
+    uint8_t next = (tx_head_ + 1) % SERIAL_TX_BUFFER_SIZE;
+    while (next == tx_tail_) {
+        // ring full: with interrupts off (in an ISR) the byte is moved by hand. UCSR0A is read
+        // first, so the simulator counts the spin as waiting for the USART.
+        if ((UCSR0A & _BV(UDRE0)) && !(SREG & _BV(SREG_I)))
+            _tx_udr_empty_irq();
+    }
+    tx_[tx_head_] = c;
+    uint8_t sreg = SREG;
+    cli();
+    tx_head_ = next;
+    UCSR0B |= _BV(UDRIE0);
+    SREG = sreg;
+    return 1;
+}
+
+void HardwareSerial::_rx_complete_irq()
+{
+    uint8_t c = UDR0;
+    uint8_t next = (rx_head_ + 1) % SERIAL_RX_BUFFER_SIZE;
+    if (next != rx_tail_) {
+        rx_[rx_head_] = c;
+        rx_head_ = next;
+    }
+    else
+        sim::stats.serial_overruns++;   // a full ring drops the byte
+}
+
+void HardwareSerial::_tx_udr_empty_irq()
+{
+    UDR0 = tx_[tx_tail_];
+    tx_tail_ = (tx_tail_ + 1) % SERIAL_TX_BUFFER_SIZE;
+    UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0);     // clear TXC0, flush() waits for it
+    if (tx_head_ == tx_tail_)
+        UCSR0B &= ~_BV(UDRIE0);
+}
+
+// ----------------------------------------------------------------------------------------
+// SPI
+
+void SPIClass::beginTransaction(const SPISettings &settings)
+{
+    uint32_t div = 16000000UL / (settings.clock_ ? settings.clock_ : 1);
+    if (div <= 2) setClockDivider(SPI_CLOCK_DIV2);
+    else if (div <= 4) setClockDivider(SPI_CLOCK_DIV4);
+    else if (div <= 8) setClockDivider(SPI_CLOCK_DIV8);
+    else if (div <= 16) setClockDivider(SPI_CLOCK_DIV16);
+    else if (div <= 32) setClockDivider(SPI_CLOCK_DIV32);
+    else if (div <= 64) setClockDivider(SPI_CLOCK_DIV64);
+    else setClockDivider(SPI_CLOCK_DIV128);
+}
+
+// ----------------------------------------------------------------------------------------
+// SD card in a host directory
+
+namespace sim
+{
+    const char *sd_root = "sd";
+
+    struct sd_file
+    {
+        FILE       *fp;
+        std::string name;
+        uint32_t    size;
+        uint32_t    pos;
+        bool        append;
+        int         refs;
+    };
+
+    namespace
+    {
+        const uint32_t block_size = 512;
+        const uint32_t cluster_blocks = 8;
+
+        // the single block cache of the volume
+        const sd_file *cache_file;
+        uint32_t       cache_block = 0xFFFFFFFFUL;
+        bool           cache_dirty;
+
+        void cache_flush()
+        {
+            if (cache_dirty) {
+                advance_us(sd_block_write_us);
+                stats.sd_sector_writes++;
+                cache_dirty = false;
+            }
+        }
+
+        void cache_fetch(const sd_file *f, uint32_t pos, bool for_write)
+        {
+            uint32_t block = pos / block_size;
+            if (cache_file == f && cache_block == block)
+                return;
+            cache_flush();
+            // a block that is written completely from its start does not need to be read first
+            if (!(for_write && pos % block_size == 0 && pos >= f->size)) {
+                advance_us(sd_block_read_us);
+                stats.sd_sector_reads++;
+            }
+            cache_file = f;
+            cache_block = block;
+        }
+
+        std::string host_path(const char *path)
+        {
+            while (*path == '/')
+                path++;
+            return std::string(sd_root) + "/" + path;
+        }
+    }
+}
+
+File::File(sim::sd_file *f) : file_(f)
+{
+    if (file_)
+        file_->refs++;
+}
+
+File::File(const File &other) : Stream(), file_(other.file_)
+{
+    if (file_)
+        file_->refs++;
+}
+
+File &File::operator=(const File &other)
+{
+    if (other.file_)
+        other.file_->refs++;
+    close();
+    file_ = other.file_;
+    return *this;
+}
+
+File::~File()
+{
+    close();
+}
+
+void File::close()
+{
+    if (!file_)
+        return;
+    flush();
+    if (--file_->refs == 0) {
+        if (sim::cache_file == file_)
+            sim::cache_file = 0;
+        fclose(file_->fp);
+        delete file_;
+    }
+    file_ = 0;
+}
+
+int File::read(void *buf, uint16_t nbyte)
+{
+    if (!file_)
+        return -1;
+    uint8_t *dst = (uint8_t *)buf;
+    int count = 0;
+    sim::advance(20);
+    while (nbyte && file_->pos < file_->size) {
+        sim::cache_fetch(file_, file_->pos, false);
+        uint32_t chunk = sim::block_size - file_->pos % sim::block_size;
+        if (chunk > nbyte) chunk = nbyte;
+        if (chunk > file_->size - file_->pos) chunk = file_->size - file_->pos;
+        fseek(file_->fp, file_->pos, SEEK_SET);
+        chunk = fread(dst, 1, chunk, file_->fp);
+        if (!chunk)
+            break;
+        sim::advance(5 * chunk);    // copy out of the cache block
+        file_->pos += chunk;
+        dst += chunk;
+        count += chunk;
+        nbyte -= chunk;
+    }
+    return count;
+}
+
+int File::read()
+{
+    uint8_t b;
+    sim::advance(80);   // per call overhead of SdFile::read for a single byte
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int File::peek()
+{
+    if (!file_)
+        return -1;
+    uint32_t pos = file_->pos;
+    int c = read();
+    file_->pos = pos;
+    return c;
+}
+
+int File::available()
+{
+    if (!file_)
+        return 0;
+    uint32_t n = file_->size - file_->pos;
+    return n > 0x7FFF ? 0x7FFF : (int)n;
+}
+
+size_t File::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size)
+{
+    if (!file_)
+        return 0;
+    if (file_->append)
+        file_->pos = file_->size;
+    size_t count = 0;
+    sim::advance(20);
+    while (count < size) {
+        if (file_->pos >= file_->size && file_->pos % (sim::block_size * sim::cluster_blocks) == 0) {
+            // growing into a new cluster updates the FAT
+            sim::cache_flush();
+            sim::advance_us(sim::sd_block_read_us + sim::sd_block_write_us);
+            sim::stats.sd_sector_reads++;
+            sim::stats.sd_sector_writes++;
+            sim::cache_file = 0;
+        }
+        sim::cache_fetch(file_, file_->pos, true);
+        uint32_t chunk = sim::block_size - file_->pos % sim::block_size;
+        if (chunk > size - count) chunk = size - count;
+        fseek(file_->fp, file_->pos, SEEK_SET);
+        fwrite(buf + count, 1, chunk, file_->fp);
+        sim::advance(5 * chunk);
+        sim::cache_dirty = true;
+        file_->pos += chunk;
+        count += chunk;
+        if (file_->pos > file_->size)
+            file_->size = file_->pos;
+    }
+    return count;
+}
+
+void File::flush()
+{
+    if (!file_)
+        return;
+    if (sim::cache_file == file_ && sim::cache_dirty) {
+        sim::cache_flush();
+        // directory entry update
+        sim::advance_us(sim::sd_block_read_us + sim::sd_block_write_us);
+    }
+    fflush(file_->fp);
+}
+
+bool File::seek(uint32_t pos)
+{
+    if (!file_ || pos > file_->size)
+        return false;
+    file_->pos = pos;
+    return true;
+}
+
+uint32_t File::position()
+{
+    return file_ ? file_->pos : 0;
+}
+
+uint32_t File::size()
+{
+    return file_ ? file_->size : 0;
+}
+
+const char *File::name()
+{
+    return file_ ? file_->name.c_str() : "";
+}
+
+bool SDClass::begin(uint8_t)
+{
+    FILE *probe = fopen((std::string(sim::sd_root) + "/.").c_str(), "r");
+    if (!probe)
+        return false;
+    fclose(probe);
+    return true;
+}
+
+File SDClass::open(const char *filename, uint8_t mode)
+{
+    std::string path = sim::host_path(filename);
+    FILE *fp = 0;
+    if (mode & O_WRITE) {
+        if (!(mode & O_TRUNC))
+            fp = fopen(path.c_str(), "r+b");
+        if (!fp && (mode & O_CREAT))
+            fp = fopen(path.c_str(), "w+b");
+    }
+    else
+        fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return File();
+
+    sim::sd_file *f = new sim::sd_file;
+    f->fp = fp;
+    f->name = filename;
+    fseek(fp, 0, SEEK_END);
+    f->size = (uint32_t)ftell(fp);
+    f->append = (mode & O_APPEND) != 0;
+    f->pos = f->append ? f->size : 0;
+    f->refs = 0;
+    sim::advance_us(sim::sd_block_read_us);     // directory lookup
+    return File(f);
+}
+
+bool SDClass::exists(const char *filepath)
+{
+    FILE *fp = fopen(sim::host_path(filepath).c_str(), "rb");
+    if (!fp)
+        return false;
+    fclose(fp);
+    return true;
+}
+
+bool SDClass::remove(const char *filepath)
+{
+    return ::remove(sim::host_path(filepath).c_str()) == 0;
+}
+
+bool SDClass::mkdir(const char *filepath)
+{
+    return ::mkdir(sim::host_path(filepath).c_str(), 0777) == 0;
+}
+
+// ----------------------------------------------------------------------------------------
+// main
+
+// pio test builds the firmware sources with the tests in test/, which bring their own main()
+#if !defined(PIO_UNIT_TESTING)
+
+namespace
+{
+    bool load_chip(sim::socket_chip *chip, const char *path)
+    {
+        FILE *fp = fopen(path, "rb");
+        if (!fp)
+            return false;
+        fread(chip->memory(), 1, chip->size(), fp);
+        fclose(fp);
+        return true;
+    }
+
+    bool save_chip(const sim::socket_chip *chip, const char *path)
+    {
+        FILE *fp = fopen(path, "wb");
+        if (!fp)
+            return false;
+        fwrite(const_cast<sim::socket_chip *>(chip)->memory(), 1, chip->size(), fp);
+        fclose(fp);
+        return true;
+    }
+
+    void print_counters(const char *label, const sim::counters &c)
+    {
+        fprintf(stderr,
+                "%s: time_us=%llu cycles=%llu io=%llu spi_bytes=%llu latches=%llu delay_us=%llu "
+                "serial_tx=%llu serial_rx=%llu serial_wait_us=%llu serial_overruns=%llu sd_reads=%llu sd_writes=%llu "
+                "bus_conflicts=%llu interrupts=%llu\n",
+                label,
+                (unsigned long long)(c.cycles / sim::cycles_per_us),
+                (unsigned long long)c.cycles,
+                (unsigned long long)c.io_accesses,
+                (unsigned long long)c.spi_bytes,
+                (unsigned long long)c.latch_pulses,
+                (unsigned long long)c.delay_us,
+                (unsigned long long)c.serial_tx_bytes,
+                (unsigned long long)c.serial_rx_bytes,
+                (unsigned long long)c.serial_wait_us,
+                (unsigned long long)c.serial_overruns,
+                (unsigned long long)c.sd_sector_reads,
+                (unsigned long long)c.sd_sector_writes,
+                (unsigned long long)c.bus_conflicts,
+                (unsigned long long)c.interrupts);
+    }
+
+    sim::counters difference(const sim::counters &a, const sim::counters &b)
+    {
+        sim::counters d;
+        d.cycles = a.cycles - b.cycles;
+        d.io_accesses = a.io_accesses - b.io_accesses;
+        d.spi_bytes = a.spi_bytes - b.spi_bytes;
+        d.latch_pulses = a.latch_pulses - b.latch_pulses;
+        d.delay_us = a.delay_us - b.delay_us;
+        d.serial_tx_bytes = a.serial_tx_bytes - b.serial_tx_bytes;
+        d.serial_rx_bytes = a.serial_rx_bytes - b.serial_rx_bytes;
+        d.serial_wait_us = a.serial_wait_us - b.serial_wait_us;
+        d.serial_overruns = a.serial_overruns - b.serial_overruns;
+        d.sd_sector_reads = a.sd_sector_reads - b.sd_sector_reads;
+        d.sd_sector_writes = a.sd_sector_writes - b.sd_sector_writes;
+        d.bus_conflicts = a.bus_conflicts - b.bus_conflicts;
+        d.interrupts = a.interrupts - b.interrupts;
+        return d;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *chip_in = 0;
+    const char *chip_out = 0;
+    const char *socket_in[sim::gang_max_sockets] = { 0 };
+    int socket = -1;                // target of --chip-in and --program-us on the gang board
+    uint16_t access_ns = 0;
+    bool profile = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : 0;
+        if (arg == "--profile")
+            profile = true;
+        else if (arg == "--xonxoff")
+            sim::serial_xonxoff = true;
+        else if (value && arg == "--sd")
+            sim::sd_root = argv[++i];
+        else if (value && arg == "--chip-type") {
+            std::string type = argv[++i];
+            if (type == "w27c512")
+                sim::chip = &sim::w27c512_chip;
+            else if (type == "at28c256")
+                sim::chip = &sim::at28c256_chip;
+            else if (type == "at27c040")
+                sim::chip = &sim::at27c040_chip;
+            else {
+                fprintf(stderr, "unknown chip type %s (w27c512, at28c256, at27c040)\n", value);
+                return 2;
+            }
+        }
+        else if (value && arg == "--chip-in") {
+            if (socket >= 0)
+                socket_in[socket] = argv[++i];
+            else
+                chip_in = argv[++i];
+        }
+        else if (value && arg == "--chip-out")
+            chip_out = argv[++i];
+        else if (value && arg == "--program-us") {
+            uint16_t us = (uint16_t)atoi(argv[++i]);
+            if (socket >= 0)
+                static_cast<sim::eprom *>(sim::gang[socket])->program_time_us = us;
+            else {
+                sim::w27c512_chip.program_time_us = sim::at27c040_chip.program_time_us = us;
+                for (uint8_t n = 0; n < sim::gang_size; n++)
+                    static_cast<sim::eprom *>(sim::gang[n])->program_time_us = us;
+            }
+        }
+        else if (value && arg == "--gang" && !sim::gang_size) {
+            int n = atoi(argv[++i]);
+            if (n < 1 || n > sim::gang_max_sockets) {
+                fprintf(stderr, "--gang takes 1..%d sockets\n", sim::gang_max_sockets);
+                return 2;
+            }
+            for (sim::gang_size = 0; sim::gang_size < n; sim::gang_size++)
+                sim::gang[sim::gang_size] = new sim::eprom(0x10000UL, 0xDA, 0x08);
+        }
+        else if (value && arg == "--socket" && atoi(value) >= 0 && atoi(value) < sim::gang_size)
+            socket = atoi(argv[++i]);
+        else if (value && arg == "--write-us")
+            sim::at28c256_chip.write_time_us = (uint32_t)atoi(argv[++i]);
+        else if (value && arg == "--access-ns")
+            access_ns = (uint16_t)atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--sd DIR] [--chip-type w27c512|at28c256|at27c040] [--chip-in FILE] "
+                            "[--chip-out FILE] [--program-us N] [--write-us N] [--access-ns N] "
+                            "[--gang N [--socket K ...]] [--xonxoff] [--profile]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (access_ns)
+        sim::chip->access_time_ns = access_ns;
+    for (uint8_t n = 0; n < sim::gang_size; n++) {
+        const char *path = socket_in[n] ? socket_in[n] : chip_in;
+        if (access_ns)
+            sim::gang[n]->access_time_ns = access_ns;
+        if (path && !load_chip(sim::gang[n], path)) {
+            fprintf(stderr, "cannot read %s\n", path);
+            return 2;
+        }
+    }
+    if (!sim::gang_size && chip_in && !load_chip(sim::chip, chip_in)) {
+        fprintf(stderr, "cannot read %s\n", chip_in);
+        return 2;
+    }
+
+    setup();
+
+    unsigned idle_passes = 0;
+    sim::counters last_work = sim::stats;   // the idle tail is not part of the totals
+    sim::counters before = sim::stats;
+    for (;;) {
+        loop();
+        if (Serial.available())             // serialEventRun() of the core
+            serialEvent();
+        sim::advance(sim::cycles_per_us);   // loop() call overhead
+
+        bool busy = sim::stats.io_accesses != before.io_accesses
+                 || sim::stats.serial_tx_bytes != before.serial_tx_bytes;
+        if (busy && profile) {
+            char label[32];
+            snprintf(label, sizeof(label), "pass @%lluus", (unsigned long long)(before.cycles / sim::cycles_per_us));
+            print_counters(label, difference(sim::stats, before));
+        }
+        // work done by interrupts while the firmware waited makes the next pass busy
+        before = sim::stats;
+        if (busy) {
+            idle_passes = 0;
+            last_work = sim::stats;
+            continue;
+        }
+        if (sim::serial_input_closed() && !sim::serial_line_busy()) {
+            // a job may still wait for time to pass (erase pulse), so idle passes take 1 ms
+            sim::advance_us(1000);
+            if (++idle_passes > 1000)
+                break;
+        }
+        else
+            sim::serial_wait_input();
+    }
+    fflush(stdout);
+
+    print_counters("total", last_work);
+    if (!sim::gang_size) {
+        fprintf(stderr, "chip: program_pulses=%u erase_pulses=%u\n",
+                (unsigned)sim::chip->program_pulses, (unsigned)sim::chip->erase_pulses);
+        if (chip_out && !save_chip(sim::chip, chip_out)) {
+            fprintf(stderr, "cannot write %s\n", chip_out);
+            return 1;
+        }
+    }
+    for (uint8_t n = 0; n < sim::gang_size; n++) {
+        fprintf(stderr, "socket %u: program_pulses=%u erase_pulses=%u\n", (unsigned)n,
+                (unsigned)sim::gang[n]->program_pulses, (unsigned)sim::gang[n]->erase_pulses);
+        std::string path = chip_out ? std::string(chip_out) + "." + std::to_string(n) : "";
+        if (chip_out && !save_chip(sim::gang[n], path.c_str())) {
+            fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif // PIO_UNIT_TESTING
+
+#endif // EEPROGRAMMER_HOST
@@ -0,0 +1,19 @@
+/// avr/interrupt.h replacement for the host build: ISR() defines the vector function that the
+/// simulated peripherals in sim.cpp call, cli()/sei() switch the simulated interrupt flag.
+
+#if !defined(HOST_AVR_INTERRUPT_H_)
+#define HOST_AVR_INTERRUPT_H_
+
+#include "../sim.h"
+
+#define _VECTOR(N) __vector_ ## N
+#define TIMER1_COMPA_vect _VECTOR(11)
+#define USART_RX_vect _VECTOR(18)
+#define USART_UDRE_vect _VECTOR(19)
+
+#define ISR(vector) extern "C" void vector(void); extern "C" void vector(void)
+
+inline void cli() { sim::set_interrupts(false); }
+inline void sei() { sim::set_interrupts(true); }
+
+#endif // HOST_AVR_INTERRUPT_H_
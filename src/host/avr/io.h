@@ -0,0 +1,96 @@
+/// avr/io.h replacement for the host build: the port, SPI, timer and USART registers are
+/// simulated objects (see sim.h) instead of memory mapped I/O.
+
+#if !defined(HOST_AVR_IO_H_)
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+#include "../sim.h"
+
+namespace sim
+{
+    extern io_register PINB, DDRB, PORTB;
+    extern io_register PINC, DDRC, PORTC;
+    extern io_register PIND, DDRD, PORTD;
+    extern io_register SPCR, SPSR, SPDR;
+    extern io_register TCCR1A, TCCR1B, TIMSK1, TIFR1;
+    extern io_register16 TCNT1, OCR1A;
+    extern io_register UCSR0A, UCSR0B, UCSR0C, UBRR0L, UBRR0H, UDR0;
+    extern io_register SREG;
+}
+
+#define PINB  sim::PINB
+#define DDRB  sim::DDRB
+#define PORTB sim::PORTB
+#define PINC  sim::PINC
+#define DDRC  sim::DDRC
+#define PORTC sim::PORTC
+#define PIND  sim::PIND
+#define DDRD  sim::DDRD
+#define PORTD sim::PORTD
+#define SPCR  sim::SPCR
+#define SPSR  sim::SPSR
+#define SPDR  sim::SPDR
+#define TCCR1A sim::TCCR1A
+#define TCCR1B sim::TCCR1B
+#define TCNT1  sim::TCNT1
+#define OCR1A  sim::OCR1A
+#define TIMSK1 sim::TIMSK1
+#define TIFR1  sim::TIFR1
+#define UCSR0A sim::UCSR0A
+#define UCSR0B sim::UCSR0B
+#define UCSR0C sim::UCSR0C
+#define UBRR0L sim::UBRR0L
+#define UBRR0H sim::UBRR0H
+#define UDR0   sim::UDR0
+#define SREG   sim::SREG
+
+#define SPIE  7
+#define SPE   6
+#define DORD  5
+#define MSTR  4
+#define CPOL  3
+#define CPHA  2
+#define SPR1  1
+#define SPR0  0
+#define SPIF  7
+#define WCOL  6
+#define SPI2X 0
+
+#define CS10  0
+#define CS11  1
+#define CS12  2
+#define WGM12 3
+#define OCIE1A 1
+#define OCF1A 1
+
+#define RXC0  7
+#define TXC0  6
+#define UDRE0 5
+#define FE0   4
+#define DOR0  3
+#define UPE0  2
+#define U2X0  1
+#define MPCM0 0
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UCSZ01 2
+#define UCSZ00 1
+
+#define SREG_I 7
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+
+#if !defined(_BV)
+#define _BV(bit) (1 << (bit))
+#endif
+
+#endif // HOST_AVR_IO_H_
@@ -0,0 +1,29 @@
+/// avr/pgmspace.h replacement for the host build: flash and RAM share one address space.
+
+#if !defined(HOST_AVR_PGMSPACE_H_)
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define strcasecmp_P strcasecmp
+#define strcpy_P   strcpy
+#define strncat_P  strncat
+#define strlen_P   strlen
+#define memcpy_P   memcpy
+#define sprintf_P  sprintf
+#define snprintf_P snprintf
+
+#endif // HOST_AVR_PGMSPACE_H_
@@ -0,0 +1,712 @@
+#if defined(EEPROGRAMMER_HOST)
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include "sim.h"
+#include "avr/io.h"
+#include "avr/interrupt.h"
+
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));   // ISR() in the firmware
+extern "C" void USART_RX_vect(void) __attribute__((weak));
+extern "C" void USART_UDRE_vect(void) __attribute__((weak));
+
+namespace sim
+{
+    counters stats;
+    eprom w27c512_chip(0x10000UL, 0xDA, 0x08);
+    eprom at27c040_chip(0x80000UL, 0x1E, 0x0B);
+    at28c256 at28c256_chip;
+    socket_chip *chip = &w27c512_chip;
+    socket_chip *gang[gang_max_sockets];
+    uint8_t gang_size;
+    bool serial_xonxoff;
+
+    namespace
+    {
+        // wiring of the programmer, see the pin table at the top of main.cpp
+        const uint8_t CE_bit      = 2;  // PD2
+        const uint8_t A9_VPE_bit  = 3;  // PD3
+        const uint8_t OE_bit      = 4;  // PD4
+        const uint8_t OE_VPP_bit  = 5;  // PD5
+        const uint8_t LATCH_bit   = 1;  // PB1
+        const uint8_t MISO_bit    = 4;  // PB4
+        const uint8_t DATA_low_mask  = 0x3F;    // PC0..PC5 = D0..D5
+        const uint8_t DATA_high_mask = 0xC0;    // PD6..PD7 = D6..D7
+
+        const uint8_t SPIF_bit = 7;
+        const uint8_t SPI2X_bit = 0;
+        const uint8_t OCF1A_bit = 1;
+        const uint8_t OCIE1A_bit = 1;
+        const uint8_t WGM12_bit = 3;
+        const uint8_t RXC0_bit = 7, TXC0_bit = 6, UDRE0_bit = 5, DOR0_bit = 3, U2X0_bit = 1;
+        const uint8_t RXCIE0_bit = 7, UDRIE0_bit = 5, RXEN0_bit = 4, TXEN0_bit = 3;
+        const uint8_t SREG_I_bit = 7;
+        const uint8_t isr_cycles = 24;      // vector, prologue/epilogue and reti around the body
+        const uint64_t never = ~(uint64_t)0;
+
+        uint8_t regs[0x100];
+
+        uint32_t shift_register;    // 595 shift stages, MSB first; the fourth 595 is the gang board
+        uint32_t storage_register;  // 595 output latches
+        bool     latch_level;
+        uint64_t spi_done;          // cycle at which the running SPI transfer completes
+        bool     spi_busy;
+        bool     interrupts_on = true;  // the Arduino core enables interrupts before setup()
+        uint8_t  temp;              // TEMP register of the 16 bit timer accesses
+        uint64_t t1_cycle;          // Timer1 had the count t1_count at t1_cycle
+        uint16_t t1_count;
+        uint64_t t1_match = never;  // cycle of the next compare match A
+
+        // USART0. The other side of the line sends what stdin has: its bytes wait in line_
+        // until they are on the wire, one byte time each, back to back while stdin has more.
+        uint8_t  line_[4096];
+        uint16_t line_head, line_count;
+        bool     stdin_eof;
+        uint64_t rx_done = never;   // the byte on the wire is received
+        uint64_t rx_poll_at;        // next look at stdin while the line is idle
+        uint8_t  rx_fifo[2];        // the two level receive buffer behind UDR0
+        uint8_t  rx_fifo_count;
+        uint64_t tx_done = never;   // the byte in the transmit shift register is out
+        uint8_t  tx_udr;            // byte written to UDR0 waiting for the shift register
+        bool     tx_udr_full;
+        bool     rx_paused;         // XOFF received by the other side
+        bool     in_isr;
+        bool     status_polling;    // the firmware is spinning on UCSR0A
+        uint64_t last_status_poll;
+        uint64_t status_wait_cycles;
+
+        inline bool bit(uint8_t reg, uint8_t b) { return (regs[reg] >> b) & 1; }
+
+        /// level of an output pin; inputs are pulled up by the external circuitry
+        inline bool out_level(uint8_t port, uint8_t ddr, uint8_t b)
+        {
+            return bit(ddr, b) ? bit(port, b) : true;
+        }
+
+        uint8_t mcu_data_out()
+        {
+            return (regs[addr_PORTC] & DATA_low_mask) | (regs[addr_PORTD] & DATA_high_mask);
+        }
+
+        uint8_t mcu_data_ddr()
+        {
+            return (regs[addr_DDRC] & DATA_low_mask) | (regs[addr_DDRD] & DATA_high_mask);
+        }
+
+        uint16_t spi_cycles_per_byte()
+        {
+            static const uint8_t dividers[4] = { 4, 16, 64, 128 };
+            uint16_t div = dividers[regs[addr_SPCR] & 0x03];
+            if (bit(addr_SPSR, SPI2X_bit))
+                div /= 2;
+            return 8 * div + 1;
+        }
+
+        void update_devices()
+        {
+            bool latch = out_level(addr_PORTB, addr_DDRB, LATCH_bit);
+            if (latch && !latch_level) {
+                storage_register = shift_register;
+                stats.latch_pulses++;
+            }
+            latch_level = latch;
+
+            bool ce = out_level(addr_PORTD, addr_DDRD, CE_bit);
+            bool oe = out_level(addr_PORTD, addr_DDRD, OE_bit);
+            bool oe_hv = bit(addr_DDRD, OE_VPP_bit) && bit(addr_PORTD, OE_VPP_bit);
+            bool a9_hv = bit(addr_DDRD, A9_VPE_bit) && bit(addr_PORTD, A9_VPE_bit);
+            uint8_t data = mcu_data_out() | ~mcu_data_ddr();
+            uint8_t drivers = 0;
+
+            if (!gang_size) {
+                chip->update(ce, oe, oe_hv, a9_hv, storage_register, data);
+                drivers = chip->drives_bus();
+            }
+            // the CE lines of the gang board come from the fourth 595, enabled by CE
+            for (uint8_t n = 0; n < gang_size; n++) {
+                gang[n]->update(ce || ((storage_register >> (24 + n)) & 1), oe, oe_hv, a9_hv,
+                                storage_register, data);
+                drivers += gang[n]->drives_bus();
+            }
+            if ((drivers && mcu_data_ddr()) || drivers > 1)
+                stats.bus_conflicts++;
+        }
+
+        // data bus level from the chips; sockets driving it at the same time pull bits low
+        uint8_t chip_output()
+        {
+            uint8_t out = 0xFF;
+            if (!gang_size && chip->drives_bus())
+                out = chip->output();
+            for (uint8_t n = 0; n < gang_size; n++)
+                if (gang[n]->drives_bus())
+                    out &= gang[n]->output();
+            return out;
+        }
+
+        uint8_t read_pins(uint8_t port, uint8_t ddr, uint8_t data_mask)
+        {
+            uint8_t value = regs[port];
+            uint8_t inputs = ~regs[ddr];
+            uint8_t external = chip_output();
+            if (port == addr_PORTB)
+                external = 0xFF & ~(1 << MISO_bit);
+            return (value & ~(inputs & data_mask)) | (external & inputs & data_mask);
+        }
+
+        uint16_t t1_prescaler()
+        {
+            static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+            return prescalers[regs[addr_TCCR1B] & 0x07];   // external clock is not modelled
+        }
+
+        uint16_t t1_ocr() { return regs[addr_OCR1AL] | regs[addr_OCR1AH] << 8; }
+
+        // counts per timer period: TOP is OCR1A in CTC mode, 0xFFFF in normal mode
+        uint32_t t1_period() { return bit(addr_TCCR1B, WGM12_bit) ? t1_ocr() + 1UL : 0x10000UL; }
+
+        uint16_t t1_now()
+        {
+            uint16_t prescaler = t1_prescaler();
+            if (!prescaler)
+                return t1_count;
+            return (t1_count + (stats.cycles - t1_cycle) / prescaler) % t1_period();
+        }
+
+        // restart the bookkeeping at the current count after a change of the timer setup
+        void t1_rebase(uint16_t count)
+        {
+            uint16_t prescaler = t1_prescaler();
+            t1_count = count;
+            t1_cycle = stats.cycles;
+            t1_match = never;
+            if (!prescaler)
+                return;
+            uint16_t ocr = t1_ocr();
+            uint32_t counts = ocr > count ? ocr - count : t1_period() - count + ocr;
+            t1_match = t1_cycle + (uint64_t)counts * prescaler;
+        }
+
+        // cycles per 8N1 frame (start + 8 data + stop bit) at the UBRR0 rate
+        uint64_t usart_byte_cycles()
+        {
+            uint32_t ubrr = regs[addr_UBRR0L] | (regs[addr_UBRR0H] & 0x0F) << 8;
+            return 10ULL * (bit(addr_UCSR0A, U2X0_bit) ? 8 : 16) * (ubrr + 1);
+        }
+
+        // take what stdin has without blocking
+        void line_fill()
+        {
+            if (stdin_eof || line_count)
+                return;
+            struct pollfd pfd = { 0, POLLIN, 0 };
+            if (poll(&pfd, 1, 0) <= 0)
+                return;
+            ssize_t n = ::read(0, line_, sizeof(line_));
+            if (n <= 0)
+                stdin_eof = true;
+            else {
+                line_head = 0;
+                line_count = (uint16_t)n;
+            }
+        }
+
+        // while the receiver is on and the line idle, look at stdin once per byte time; the
+        // first byte after a pause takes a byte time from then
+        void line_poll()
+        {
+            if (rx_done != never || stdin_eof || rx_paused || stats.cycles < rx_poll_at
+                || !bit(addr_UCSR0B, RXEN0_bit))
+                return;
+            line_fill();
+            if (line_count)
+                rx_done = stats.cycles + usart_byte_cycles();
+            else
+                rx_poll_at = stats.cycles + usart_byte_cycles();
+        }
+
+        void rx_complete()
+        {
+            uint8_t c = line_[line_head++];
+            line_count--;
+            stats.serial_rx_bytes++;
+            if (rx_fifo_count < sizeof(rx_fifo))
+                rx_fifo[rx_fifo_count++] = c;
+            else {
+                regs[addr_UCSR0A] |= 1 << DOR0_bit;
+                stats.serial_overruns++;
+            }
+            line_fill();
+            if (line_count && !rx_paused)
+                rx_done += usart_byte_cycles();
+            else {
+                rx_done = never;
+                rx_poll_at = stats.cycles + usart_byte_cycles();
+            }
+        }
+
+        void tx_start(uint8_t c)
+        {
+            putchar(c);
+            stats.serial_tx_bytes++;
+            if (serial_xonxoff && (c == 0x11 || c == 0x13)) {
+                rx_paused = c == 0x13;
+                rx_poll_at = stats.cycles;
+            }
+            tx_done = stats.cycles + usart_byte_cycles();
+        }
+
+        void tx_complete()
+        {
+            tx_done = never;
+            if (tx_udr_full) {
+                tx_udr_full = false;
+                tx_start(tx_udr);
+            }
+            else
+                regs[addr_UCSR0A] |= 1 << TXC0_bit;
+        }
+
+        uint8_t usart_status()
+        {
+            return (regs[addr_UCSR0A] & ((1 << TXC0_bit) | (1 << DOR0_bit) | (1 << U2X0_bit) | 1))
+                 | (rx_fifo_count ? 1 << RXC0_bit : 0) | (tx_udr_full ? 0 : 1 << UDRE0_bit);
+        }
+
+        // The time between two reads of UCSR0A in a row counts as waiting for the USART. Only
+        // accesses outside of interrupt handlers to registers other than the USART and SREG
+        // end a wait.
+        void track_status_poll(uint8_t address, bool status_read)
+        {
+            if (in_isr)
+                return;
+            if (status_read) {
+                if (status_polling) {
+                    status_wait_cycles += stats.cycles - last_status_poll;
+                    stats.serial_wait_us = status_wait_cycles / cycles_per_us;
+                }
+                status_polling = true;
+                last_status_poll = stats.cycles;
+            }
+            else if (address != addr_SREG && (address < addr_UCSR0A || address > addr_UDR0))
+                status_polling = false;
+        }
+
+        // the pending interrupt with the highest priority (lowest vector), 0 if none
+        void (*pending_interrupt())(void)
+        {
+            if ((regs[addr_TIFR1] & regs[addr_TIMSK1] & (1 << OCF1A_bit)) && TIMER1_COMPA_vect) {
+                regs[addr_TIFR1] &= ~(1 << OCF1A_bit);  // cleared by executing the handler
+                return TIMER1_COMPA_vect;
+            }
+            if (rx_fifo_count && bit(addr_UCSR0B, RXCIE0_bit) && USART_RX_vect)
+                return USART_RX_vect;   // the handler has to read UDR0
+            if (!tx_udr_full && bit(addr_UCSR0B, UDRIE0_bit) && USART_UDRE_vect)
+                return USART_UDRE_vect; // the handler has to write UDR0 or clear UDRIE0
+            return 0;
+        }
+
+        void run_interrupts()
+        {
+            while (interrupts_on) {
+                void (*handler)(void) = pending_interrupt();
+                if (!handler)
+                    return;
+                interrupts_on = false;
+                in_isr = true;
+                stats.interrupts++;
+                advance(isr_cycles);
+                handler();
+                in_isr = false;
+                interrupts_on = true;
+            }
+        }
+
+        void spi_poll()
+        {
+            if (spi_busy && stats.cycles >= spi_done) {
+                spi_busy = false;
+                regs[addr_SPSR] |= 1 << SPIF_bit;
+            }
+        }
+    }
+
+    void advance(uint64_t cycles)
+    {
+        uint64_t end = stats.cycles + cycles;
+
+        // stop at every compare match and USART event on the way so its interrupt runs at the
+        // right time
+        for (;;) {
+            line_poll();
+            uint64_t next = t1_match;
+            if (rx_done < next)
+                next = rx_done;
+            if (tx_done < next)
+                next = tx_done;
+            if (next > end)
+                break;
+            uint64_t rest = end - next;
+            stats.cycles = next;
+            if (next == t1_match) {
+                t1_rebase(t1_ocr());
+                regs[addr_TIFR1] |= 1 << OCF1A_bit;
+            }
+            if (next == rx_done)
+                rx_complete();
+            if (next == tx_done)
+                tx_complete();
+            run_interrupts();
+            end = stats.cycles + rest;
+        }
+        stats.cycles = end;
+    }
+
+    void set_interrupts(bool enabled)
+    {
+        interrupts_on = enabled;
+        advance(1);
+        run_interrupts();
+    }
+
+    bool serial_input_closed()
+    {
+        return stdin_eof && !line_count && rx_done == never && !rx_fifo_count;
+    }
+
+    bool serial_line_busy()
+    {
+        return rx_done != never || tx_done != never;
+    }
+
+    void serial_wait_input()
+    {
+        uint64_t next = rx_done < tx_done ? rx_done : tx_done;
+        if (next != never) {
+            advance(next - stats.cycles);
+            return;
+        }
+        if (stdin_eof || rx_paused) {
+            advance_us(1000);       // until the firmware reads its RX ring and sends XON
+            return;
+        }
+        fflush(stdout);
+        struct pollfd pfd = { 0, POLLIN, 0 };
+        poll(&pfd, 1, 50);
+        rx_poll_at = stats.cycles;
+    }
+
+    void serial_idle_poll()
+    {
+        static uint64_t idle_mark;
+
+        if (stats.io_accesses == idle_mark && !serial_line_busy() && !stdin_eof
+            && bit(addr_UCSR0B, RXEN0_bit)) {
+            fflush(stdout);
+            struct pollfd pfd = { 0, POLLIN, 0 };
+            if (poll(&pfd, 1, 1) <= 0)
+                advance_us(1000);
+            rx_poll_at = stats.cycles;
+        }
+        idle_mark = stats.io_accesses;
+    }
+
+    uint32_t latched_address()
+    {
+        return storage_register & 0xFFFFFF;
+    }
+
+    uint8_t io_read(uint8_t address)
+    {
+        stats.io_accesses++;
+        advance(1);
+        spi_poll();
+        track_status_poll(address, address == addr_UCSR0A);
+        switch (address) {
+            case addr_PINB: return read_pins(addr_PORTB, addr_DDRB, 1 << MISO_bit);
+            case addr_PINC: return read_pins(addr_PORTC, addr_DDRC, DATA_low_mask);
+            case addr_PIND: return read_pins(addr_PORTD, addr_DDRD, DATA_high_mask);
+            case addr_SPDR:
+                regs[addr_SPSR] &= ~(1 << SPIF_bit);
+                return 0xFF;
+            case addr_TCNT1L: {
+                uint16_t count = t1_now();
+                temp = count >> 8;
+                return count & 0xFF;
+            }
+            case addr_TCNT1H:
+                return temp;
+            case addr_SREG:
+                return interrupts_on ? 1 << SREG_I_bit : 0;
+            case addr_UCSR0A:
+                return usart_status();
+            case addr_UDR0: {
+                if (!rx_fifo_count)
+                    return 0;
+                uint8_t c = rx_fifo[0];
+                rx_fifo[0] = rx_fifo[1];
+                rx_fifo_count--;
+                regs[addr_UCSR0A] &= ~(1 << DOR0_bit);
+                return c;
+            }
+            default:
+                return regs[address];
+        }
+    }
+
+    void io_write(uint8_t address, uint8_t value)
+    {
+        stats.io_accesses++;
+        advance(1);
+        spi_poll();
+        track_status_poll(address, false);
+        switch (address) {
+            case addr_PINB: regs[addr_PORTB] ^= value; break;  // writing PINx toggles PORTx
+            case addr_PINC: regs[addr_PORTC] ^= value; break;
+            case addr_PIND: regs[addr_PORTD] ^= value; break;
+            case addr_SPDR:
+                // the 595 chain shares MOSI/SCK, so every byte on the bus moves through it
+                shift_register = (shift_register << 8) | value;
+                regs[addr_SPSR] &= ~(1 << SPIF_bit);
+                spi_busy = true;
+                spi_done = stats.cycles + spi_cycles_per_byte();
+                stats.spi_bytes++;
+                return;
+            case addr_SPSR:
+                regs[address] = (regs[address] & 0xFE) | (value & 0x01);   // only SPI2X is writable
+                return;
+            case addr_TIFR1:
+                regs[address] &= ~value;    // flags are cleared by writing a one
+                return;
+            case addr_TCNT1H:
+            case addr_OCR1AH:
+                temp = value;
+                return;
+            case addr_TCNT1L:
+                t1_rebase(temp << 8 | value);
+                return;
+            case addr_OCR1AL:
+            case addr_TCCR1B: {
+                uint16_t count = t1_now();
+                if (address == addr_OCR1AL)
+                    regs[addr_OCR1AH] = temp;
+                regs[address] = value;
+                t1_rebase(count);
+                return;
+            }
+            case addr_TIMSK1:
+            case addr_UCSR0B:
+                regs[address] = value;
+                run_interrupts();
+                return;
+            case addr_SREG:
+                interrupts_on = value >> SREG_I_bit & 1;
+                run_interrupts();
+                return;
+            case addr_UCSR0A:
+                // TXC0 is cleared by writing a one, U2X0 and MPCM0 are writable
+                regs[address] = (regs[address] & ~value & (1 << TXC0_bit))
+                              | (regs[address] & (1 << DOR0_bit)) | (value & 0x03);
+                return;
+            case addr_UDR0:
+                if (!bit(addr_UCSR0B, TXEN0_bit))
+                    return;
+                if (tx_done == never)
+                    tx_start(value);
+                else {
+                    tx_udr = value;
+                    tx_udr_full = true;
+                }
+                run_interrupts();
+                return;
+            case addr_UCSR0C:
+            case addr_UBRR0L:
+            case addr_UBRR0H:
+                regs[address] = value;
+                return;
+            default:
+                regs[address] = value;
+                break;
+        }
+        update_devices();
+    }
+
+    eprom::eprom(uint32_t capacity, uint8_t manufacturer_id, uint8_t device_id)
+        : capacity(capacity), manufacturer_id(manufacturer_id), device_id(device_id),
+          mem(new uint8_t[capacity]), program_time_us(100), erase_time_us(95000UL),
+          pulse_us_(new uint16_t[capacity]),
+          ce_(true), oe_(true), oe_hv_(false), a9_hv_(false),
+          address_(0), data_in_(0xFF), t_ce_(0), t_settle_(0), last_output_(0xFF)
+    {
+        memset(mem, 0xFF, capacity);
+        memset(pulse_us_, 0, capacity * sizeof(pulse_us_[0]));
+    }
+
+    eprom::~eprom()
+    {
+        delete[] mem;
+        delete[] pulse_us_;
+    }
+
+    void eprom::update(bool ce, bool oe, bool oe_hv, bool a9_hv, uint32_t latch, uint8_t data_in)
+    {
+        uint64_t t = now();
+        uint32_t address = latch & (capacity - 1);
+
+        if (address != address_ || oe != oe_ || (!ce && ce_))
+            t_settle_ = t;
+        if (!ce && ce_)
+            t_ce_ = t;
+        if (ce && !ce_) {
+            // rising CE ends a program or erase pulse
+            uint32_t width_us = (uint32_t)((t - t_ce_) / cycles_per_us);
+            if (oe_hv_ && a9_hv_) {
+                erase_pulses++;
+                if (width_us >= erase_time_us) {
+                    memset(mem, 0xFF, capacity);
+                    memset(pulse_us_, 0, capacity * sizeof(pulse_us_[0]));
+                }
+            }
+            else if (oe_hv_) {
+                program_pulses++;
+                uint32_t sum = pulse_us_[address_] + width_us;
+                pulse_us_[address_] = sum > 0xFFFF ? 0xFFFF : (uint16_t)sum;
+                if (sum >= program_time_us) {
+                    mem[address_] &= data_in_;  // programming only moves bits from 1 to 0
+                    pulse_us_[address_] = 0;
+                }
+            }
+        }
+        ce_ = ce;
+        oe_ = oe;
+        oe_hv_ = oe_hv;
+        a9_hv_ = a9_hv;
+        address_ = address;
+        data_in_ = data_in;
+    }
+
+    bool eprom::drives_bus() const
+    {
+        return !ce_ && !oe_ && !oe_hv_;
+    }
+
+    uint8_t eprom::output()
+    {
+        uint64_t settle = (uint64_t)access_time_ns * cpu_hz / 1000000000UL;
+        if (now() - t_settle_ < settle)
+            return last_output_;
+        if (a9_hv_)
+            last_output_ = (address_ & 1) ? device_id : manufacturer_id;
+        else
+            last_output_ = mem[address_];
+        return last_output_;
+    }
+
+    at28c256::at28c256()
+        : write_time_us(5000), protected_(false),
+          ce_(true), oe_(true), we_(true), address_(0), t_settle_(0), t_load_(0), t_done_(0),
+          page_mask_(0), page_base_(0), loads_(0), last_data_(0xFF), unlocked_(false),
+          busy_(false), last_output_(0xFF)
+    {
+        memset(mem, 0xFF, sizeof(mem));
+    }
+
+    void at28c256::start_write(uint64_t t)
+    {
+        busy_ = true;
+        t_done_ = t + (uint64_t)write_time_us * cycles_per_us;
+        program_pulses++;
+    }
+
+    void at28c256::tick()
+    {
+        const uint64_t t_blc = 150 * cycles_per_us;
+        uint64_t t = now();
+
+        if (loads_ && !busy_ && t - t_load_ >= t_blc)
+            start_write(t_load_ + t_blc);
+        if (busy_ && t >= t_done_) {
+            if (unlocked_)
+                protected_ = true;
+            if (unlocked_ || !protected_)
+                for (uint8_t i = 0; i < page_size; i++)
+                    if (page_mask_ >> i & 1)
+                        mem[page_base_ + i] = page_[i];
+            busy_ = false;
+            loads_ = 0;
+            page_mask_ = 0;
+            unlocked_ = false;
+        }
+    }
+
+    void at28c256::load(uint16_t address, uint8_t data)
+    {
+        static const uint16_t sdp_address[3] = { 0x5555, 0x2AAA, 0x5555 };
+        static const uint8_t  sdp_data[3] = { 0xAA, 0x55, 0xA0 };
+
+        t_load_ = now();
+        if (loads_ < 3 && address == sdp_address[loads_] && data == sdp_data[loads_]) {
+            if (++loads_ == 3)
+                unlocked_ = true;
+            return;
+        }
+        if (!page_mask_)
+            page_base_ = address & ~(page_size - 1);
+        if ((address & ~(page_size - 1)) == page_base_) {    // A6..A14 have to stay the same
+            page_[address & (page_size - 1)] = data;
+            page_mask_ |= (uint64_t)1 << (address & (page_size - 1));
+        }
+        last_data_ = data;
+        loads_ = loads_ < 3 ? 3 : loads_ + (loads_ < 0xFF);
+    }
+
+    void at28c256::update(bool ce, bool oe, bool, bool, uint32_t latch, uint8_t data_in)
+    {
+        uint16_t address = (latch & 0x3FFF) | ((latch >> 1) & 0x4000);
+        bool we = (latch >> 14) & 1;
+
+        tick();
+        if (address != address_ || oe != oe_ || ce != ce_)
+            t_settle_ = now();
+        // the address is taken on the falling edge of /WE, the data on the rising edge
+        if (!ce && oe && !we_ && we && !busy_)
+            load(address_, data_in);
+        if (we_ || !we)
+            address_ = address;
+        ce_ = ce;
+        oe_ = oe;
+        we_ = we;
+    }
+
+    bool at28c256::drives_bus() const
+    {
+        return !ce_ && !oe_ && we_;
+    }
+
+    uint8_t at28c256::output()
+    {
+        uint64_t settle = (uint64_t)access_time_ns * cpu_hz / 1000000000UL;
+        tick();
+        if (busy_)
+            return (~last_data_ & 0x80) | (last_data_ & 0x7F);
+        if (now() - t_settle_ < settle)
+            return last_output_;
+        last_output_ = mem[address_];
+        return last_output_;
+    }
+}
+
+sim::io_register PINB(sim::addr_PINB), DDRB(sim::addr_DDRB), PORTB(sim::addr_PORTB);
+sim::io_register PINC(sim::addr_PINC), DDRC(sim::addr_DDRC), PORTC(sim::addr_PORTC);
+sim::io_register PIND(sim::addr_PIND), DDRD(sim::addr_DDRD), PORTD(sim::addr_PORTD);
+sim::io_register SPCR(sim::addr_SPCR), SPSR(sim::addr_SPSR), SPDR(sim::addr_SPDR);
+sim::io_register TCCR1A(sim::addr_TCCR1A), TCCR1B(sim::addr_TCCR1B);
+sim::io_register TIMSK1(sim::addr_TIMSK1), TIFR1(sim::addr_TIFR1);
+sim::io_register16 TCNT1(sim::addr_TCNT1L), OCR1A(sim::addr_OCR1AL);
+sim::io_register UCSR0A(sim::addr_UCSR0A), UCSR0B(sim::addr_UCSR0B), UCSR0C(sim::addr_UCSR0C);
+sim::io_register UBRR0L(sim::addr_UBRR0L), UBRR0H(sim::addr_UBRR0H), UDR0(sim::addr_UDR0);
+sim::io_register SREG(sim::addr_SREG);
+
+#endif // EEPROGRAMMER_HOST
@@ -0,0 +1,241 @@
+/// sim.h - simulated ATmega328P environment for the host build (env:native).
+/// Models just enough of the Nano to run the firmware unchanged:
+///  - the I/O registers used through pin_definitions.hpp (PORTx/PINx/DDRx) and the SPI unit,
+///  - Timer1 with the compare match A interrupt (normal and CTC mode, internal clock only),
+///  - USART0 on stdin/stdout (8N1 at the UBRR0 rate, RX complete and UDR empty interrupts),
+///  - the three cascaded 74HC595 that latch the EEPROM address,
+///  - a behavioral chip in the socket (W27C512, AT28C256, or AT27C040 in the 32 pin adapter)
+///    that reacts to CE, OE, A9_VPE,
+///    OE_VPP, the latched address and the data pins,
+///  - or the gang board: several W27C512 whose CE lines come from a fourth 595.
+/// All time is simulated: register accesses, SPI transfers, delays and serial transfers advance
+/// a 16 MHz cycle counter, so read/program/erase throughput can be measured without a bench rig.
+
+#if !defined(SIM_H_)
+#define SIM_H_
+
+#include <stdint.h>
+
+namespace sim
+{
+    const uint32_t cpu_hz = 16000000UL;
+    const uint32_t cycles_per_us = cpu_hz / 1000000UL;
+
+    /// data space addresses of the simulated registers (same numbering as the ATmega328P)
+    enum register_address {
+        addr_PINB = 0x23, addr_DDRB = 0x24, addr_PORTB = 0x25,
+        addr_PINC = 0x26, addr_DDRC = 0x27, addr_PORTC = 0x28,
+        addr_PIND = 0x29, addr_DDRD = 0x2A, addr_PORTD = 0x2B,
+        addr_TIFR1 = 0x36,
+        addr_SPCR = 0x4C, addr_SPSR = 0x4D, addr_SPDR = 0x4E,
+        addr_SREG = 0x5F,
+        addr_TIMSK1 = 0x6F,
+        addr_TCCR1A = 0x80, addr_TCCR1B = 0x81, addr_TCNT1L = 0x84, addr_TCNT1H = 0x85,
+        addr_OCR1AL = 0x88, addr_OCR1AH = 0x89,
+        addr_UCSR0A = 0xC0, addr_UCSR0B = 0xC1, addr_UCSR0C = 0xC2,
+        addr_UBRR0L = 0xC4, addr_UBRR0H = 0xC5, addr_UDR0 = 0xC6
+    };
+
+    /// counters reported at the end of a host run
+    struct counters
+    {
+        uint64_t cycles;            // simulated cpu cycles since reset
+        uint64_t io_accesses;       // reads and writes of simulated registers ("bus cycles")
+        uint64_t spi_bytes;         // bytes shifted out through SPDR
+        uint64_t latch_pulses;      // rising edges on the 595 storage clock
+        uint64_t delay_us;          // time spent in delay() / delayMicroseconds()
+        uint64_t serial_tx_bytes;
+        uint64_t serial_rx_bytes;
+        uint64_t serial_wait_us;    // time spent polling the USART status (TX ring full, flush)
+        uint64_t serial_overruns;   // bytes lost because UDR0 was not read in time (DOR)
+        uint64_t sd_sector_reads;
+        uint64_t sd_sector_writes;
+        uint64_t bus_conflicts;     // MCU and EEPROM driving the data bus at the same time
+        uint64_t interrupts;        // interrupt handlers run
+    };
+    extern counters stats;
+
+    /// advance simulated time
+    void advance(uint64_t cycles);
+    inline void advance_us(uint64_t us) { advance(us * cycles_per_us); }
+    inline uint64_t now() { return stats.cycles; }
+    inline uint64_t now_us() { return stats.cycles / cycles_per_us; }
+
+    uint8_t io_read(uint8_t address);
+    void io_write(uint8_t address, uint8_t value);
+
+    /// global interrupt flag (I in SREG), switched by cli()/sei(); a pending interrupt runs
+    /// as soon as it is set
+    void set_interrupts(bool enabled);
+
+    /// USART0: the other side stops sending after an XOFF from the firmware until an XON
+    extern bool serial_xonxoff;
+    /// true when stdin is exhausted and every byte of it went through UDR0
+    bool serial_input_closed();
+    /// true while a byte is received or sent
+    bool serial_line_busy();
+    /// Called while the firmware is idle: advances to the end of the byte on the wire, or
+    /// waits (in real time) until stdin has data or is closed.
+    void serial_wait_input();
+    /// Called by millis(): a firmware that only watches the clock, e.g. for the reply of a host
+    /// program, spins in real time instead of racing ahead, so its timeouts match the wall
+    /// clock of the other side.
+    void serial_idle_poll();
+
+    /// A simulated 8 bit I/O register. Reads and writes are routed through io_read/io_write so
+    /// the devices attached to the ports see every change.
+    class io_register
+    {
+    public:
+        explicit io_register(uint8_t address) : address_(address) {}
+
+        operator uint8_t() const { return io_read(address_); }
+        io_register &operator=(uint8_t value) { io_write(address_, value); return *this; }
+        io_register &operator|=(uint8_t value) { io_write(address_, io_read(address_) | value); return *this; }
+        io_register &operator&=(int value) { io_write(address_, io_read(address_) & value); return *this; }   // x &= ~_BV(b)
+        io_register &operator^=(uint8_t value) { io_write(address_, io_read(address_) ^ value); return *this; }
+
+    private:
+        io_register(const io_register &);
+        io_register &operator=(const io_register &);
+        uint8_t address_;
+    };
+
+    /// A 16 bit timer register pair at low, low + 1. As on the AVR the high byte goes through
+    /// the shared TEMP register: written high byte first, read low byte first.
+    class io_register16
+    {
+    public:
+        explicit io_register16(uint8_t low) : low_(low) {}
+
+        operator uint16_t() const { uint8_t l = io_read(low_); return l | io_read(low_ + 1) << 8; }
+        io_register16 &operator=(uint16_t value)
+        {
+            io_write(low_ + 1, value >> 8);
+            io_write(low_, value & 0xFF);
+            return *this;
+        }
+
+    private:
+        io_register16(const io_register16 &);
+        io_register16 &operator=(const io_register16 &);
+        uint8_t low_;
+    };
+
+    /// a chip in the 28 pin socket
+    class socket_chip
+    {
+    public:
+        socket_chip() : access_time_ns(120), program_pulses(0), erase_pulses(0) {}
+        virtual ~socket_chip() {}
+
+        /// called after every change of the control lines, the latched address or the data bus
+        virtual void update(bool ce, bool oe, bool oe_hv, bool a9_hv, uint32_t latch, uint8_t data_in) = 0;
+        virtual bool drives_bus() const = 0;
+        virtual uint8_t output() = 0;
+        virtual uint8_t *memory() = 0;
+        virtual uint32_t size() const = 0;
+
+        uint16_t access_time_ns;    // tACC / tOE
+        uint32_t program_pulses;    // program pulses, page write cycles of an EEPROM
+        uint32_t erase_pulses;
+    };
+
+    /// Behavioral model of an EPROM programmed with VPP on OE/VPP: the Winbond W27C512 (64K x 8,
+    /// electrically erasable) or, through the 32 pin adapter, a 27C010/020/040. The chip sees
+    /// the latch bits below its capacity.
+    /// Programming is cumulative: a byte takes the data on the bus once the sum of its CE pulse
+    /// widths at VPP reaches program_time_us, so too short pulses need several retries, like a
+    /// real cell. Reads return stale data if the bus is sampled before access_time_ns has passed
+    /// since the last address, CE or OE change.
+    class eprom : public socket_chip
+    {
+    public:
+        eprom(uint32_t capacity, uint8_t manufacturer_id, uint8_t device_id);
+        ~eprom();
+
+        const uint32_t capacity;
+        const uint8_t manufacturer_id;
+        const uint8_t device_id;
+        uint8_t  *mem;
+        uint16_t program_time_us;   // cumulative pulse width needed to program a byte
+        uint32_t erase_time_us;     // minimum erase pulse width
+
+        void update(bool ce, bool oe, bool oe_hv, bool a9_hv, uint32_t latch, uint8_t data_in);
+        bool drives_bus() const;
+        uint8_t output();
+        uint8_t *memory() { return mem; }
+        uint32_t size() const { return capacity; }
+
+    private:
+        eprom(const eprom &);
+        eprom &operator=(const eprom &);
+        uint16_t *pulse_us_;
+        bool     ce_, oe_, oe_hv_, a9_hv_;
+        uint32_t address_;
+        uint8_t  data_in_;
+        uint64_t t_ce_, t_settle_;
+        uint8_t  last_output_;
+    };
+
+    /// Behavioral model of an Atmel AT28C256 (32K x 8 EEPROM with 64 byte pages).
+    /// In the socket, pin 1 (A14) is driven by the A15 output of the latch and pin 27 (/WE)
+    /// by its A14 output. A falling /WE latches the address, the rising edge loads the data
+    /// into the page buffer. The write cycle (write_time_us) starts 150 us (tBLC) after the last
+    /// load; until it is done reads return the complement of bit 7 of the last byte loaded
+    /// (DATA polling). Software data protection: the loads AA/5555, 55/2AAA, A0/5555 before a
+    /// page are a command, not data, and turn the protection on. While it is on, a page
+    /// without that sequence is not written. A read does not end the load window: it returns the
+    /// old contents until the write cycle starts, and loads of another page (A6..A14) that come
+    /// before are lost.
+    class at28c256 : public socket_chip
+    {
+    public:
+        static const uint32_t capacity = 0x8000UL;
+        static const uint8_t page_size = 64;
+
+        at28c256();
+
+        uint8_t  mem[capacity];
+        uint32_t write_time_us;     // tWC
+        bool     protected_;        // software data protection on
+
+        void update(bool ce, bool oe, bool oe_hv, bool a9_hv, uint32_t latch, uint8_t data_in);
+        bool drives_bus() const;
+        uint8_t output();
+        uint8_t *memory() { return mem; }
+        uint32_t size() const { return capacity; }
+
+    private:
+        void tick();                // starts and ends write cycles as time passes
+        void start_write(uint64_t t);
+        void load(uint16_t address, uint8_t data);
+        bool     ce_, oe_, we_;
+        uint16_t address_;
+        uint64_t t_settle_, t_load_, t_done_;
+        uint8_t  page_[page_size];
+        uint64_t page_mask_;        // bytes of page_ loaded
+        uint16_t page_base_;
+        uint8_t  loads_;            // loads in the current load window
+        uint8_t  last_data_;
+        bool     unlocked_;         // current load window began with the protection sequence
+        bool     busy_;
+        uint8_t  last_output_;
+    };
+
+    extern eprom w27c512_chip;
+    extern eprom at27c040_chip;
+    extern at28c256 at28c256_chip;
+    extern socket_chip *chip;       // the chip in the socket, see --chip-type
+
+    /// Gang board (--gang N): the sockets 0..gang_size-1 take the place of chip. Socket n
+    /// sees CE low while CE is low and output n of the fourth 595 (latch bit 24 + n) is low.
+    const uint8_t gang_max_sockets = 4;
+    extern socket_chip *gang[gang_max_sockets];
+    extern uint8_t gang_size;
+
+    /// current value of the 595 storage register (the address seen by the EEPROM)
+    uint32_t latched_address();
+}
+
+#endif // SIM_H_
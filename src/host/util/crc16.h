@@ -0,0 +1,25 @@
+/// util/crc16.h replacement for the host build (same algorithms as avr-libc).
+
+#if !defined(HOST_UTIL_CRC16_H_)
+#define HOST_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+/// CRC-16/XMODEM, polynomial 0x1021, MSB first
+static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data)
+{
+    crc ^= (uint16_t)data << 8;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    return crc;
+}
+
+/// CRC-16/CCITT reflected, polynomial 0x8408
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+    data ^= crc & 0xFF;
+    data ^= data << 4;
+    return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+#endif // HOST_UTIL_CRC16_H_
@@ -0,0 +1,23 @@
+/// util/delay_basic.h replacement for the host build: the busy loops only advance the
+/// simulated cycle counter by what they take on the AVR.
+
+#if !defined(HOST_UTIL_DELAY_BASIC_H_)
+#define HOST_UTIL_DELAY_BASIC_H_
+
+#include <stdint.h>
+
+#include "../sim.h"
+
+/// 3 cycles per count, a count of 0 runs 256 times
+inline void _delay_loop_1(uint8_t count)
+{
+    sim::advance(3 * (count ? count : 256));
+}
+
+/// 4 cycles per count, a count of 0 runs 65536 times
+inline void _delay_loop_2(uint16_t count)
+{
+    sim::advance(4 * (count ? (uint32_t)count : 65536UL));
+}
+
+#endif // HOST_UTIL_DELAY_BASIC_H_
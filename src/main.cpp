@@ -1,559 +1,3180 @@
-/*
-* This code assumes following pin layout for the Arduino Nano V3:
-
-* +--------+--------+----------+----------------------+----------+------+
-* |Name    |GPIO    |Signal    |Funktionsbaustein     |Direction | init |
-* +--------+--------+----------+----------------------+----------+------+
-* | D0     | PD0    | Rx       | UART                 | I        |      |
-* | D1     | PD1    | Tx       | UART                 | O        |      |
-* | D2     | PD2    | CE       | EEPROM               | O        |   H  |
-* | D3     | PD3    | A9_VPE   | EEPROM               | O        |   L  |
-* | D4     | PD4    | OE       | EEPROM               | O        |   H  |
-* | D5     | PD5    | OE_VPP   | EEPROM               | O        |   L  |
-* | D6     | PD6    | Data_6   | EEPROM               | I/O      |      |
-* | D7     | PD7    | Data_7   | EEPROM               | I/O      |      |
-* | D8     | PB0    | VPP_VPE  | Umschaltung VPP-VPE  | O        |   L  |
-* | D9     | PB1    | LATCH    | Latch_595            | O        |   H  |
-* | D10    | PB2    | SS       | SD_CS                | O        |   H  |
-* | D11    | PB3    | MOSI     | SD_MOSI / Data_595   | O        |      |
-* | D12    | PB4    | MISO     | SD_Miso              | I        |      |
-* | D13    | PB5    | SCK      | SD_CLK / Clock_|595  | O        |      |
-* | A0     | PC0    | Data_0   | EEPROM               | I/O      |      |
-* | A1     | PC1    | Data_1   | EEPROM               | I/O      |      |
-* | A2     | PC2    | Data_2   | EEPROM               | I/O      |      |
-* | A3     | PC3    | Data_3   | EEPROM               | I/O      |      |
-* | A4     | PC4    | Data_4   | EEPROM               | I/O      |      |
-* | A5     | PC5    | Data_5   | EEPROM               | I/O      |      |
-* +--------+--------+----------+----------------------+----------+------+
-*/
-
-#include <Arduino.h>
-#include <SPI.h>
-#include <SD.h>
-
-#include "pin_definitions.hpp"
-
-uint8_t buffer[256];
-
-bool inputAvailable = false;
-String inputString;
-bool confirmation_needed = false;
-bool confirmation_given = false;
-int32_t programFile(const char *path, uint16_t adr);
-void hexDump(const char *desc, void *addr, unsigned int offset, int len);
-
-DECLARE_PIN (CE_pin, D, 2)
-DECLARE_PIN (A9_VPE_pin, D, 3)
-DECLARE_PIN (OE_pin, D, 4)
-DECLARE_PIN (OE_VPP_pin, D, 5)
-DECLARE_PIN (VPP_VPE_pin, B, 0)
-DECLARE_PIN (LATCH_pin, B, 1)
-DECLARE_PIN (SS_pin, B, 2)
-DECLARE_PIN_GROUP (DATA_low, C, 0, 6)
-DECLARE_PIN_GROUP (DATA_high, D, 6, 2)
-
-
-void enable_A9_HV()
-{
-    write(A9_VPE_pin, 1);
-}
-void disable_A9_HV()
-{
-    write(A9_VPE_pin, 0);
-}
-
-void enable_OE_VPP()
-{
-    write(OE_VPP_pin, 1);
-    //write(OE_pin, 1);
-}
-void disable_OE_VPP()
-{
-    write(OE_VPP_pin, 0);
-    //write(OE_pin, 0);
-}
-
-void eeprom_init_pins()
-{
-    set(CE_pin | OE_pin | LATCH_pin );     // sicherstellen, dass Ausgaenge HIGH sind
-    reset(A9_VPE_pin | OE_VPP_pin | VPP_VPE_pin);   // sicherstellen, dass Ausgaenge LOW sind
-    init_as_output(CE_pin | OE_pin |  LATCH_pin | A9_VPE_pin | OE_VPP_pin | VPP_VPE_pin);
-}
-void eeprom_output_enable() { 
-    write(OE_pin, 0); 
-}
-void eeprom_output_disable() { 
-    write(OE_pin, 1); 
-    delayMicroseconds(1); 
-}
-void eeprom_chip_select() { 
-    write(CE_pin, 0); 
-}
-void eeprom_chip_deselect() { 
-    write(CE_pin, 1); 
-    delayMicroseconds(1); 
-}
-void eeprom_set_data_out() { 
-    make_output(DATA_low);  
-    make_output(DATA_high); 
-}
-void eeprom_set_data_in() { // ohne pullup
-    //make_input_with_pull_ups(DATA_low);
-    //make_input_with_pull_ups(DATA_high); 
-    make_input_without_pull_ups(DATA_low);
-    make_input_without_pull_ups(DATA_high); 
-}
-
-uint8_t eeprom_data_in() 
-{ 
-    return read(DATA_low) + (read(DATA_high) << DATA_high.shift); 
-}
-
-void eeprom_data_out(uint8_t byte) { 
-    write(DATA_low, byte & DATA_low.mask );     // mask = 0x3F, shift = 0
-    write(DATA_high, byte >> DATA_high.shift);  // mask = 0xC0, shift = 6
-}
-
-void eeprom_set_address(uint16_t address)
-{
-    // todo: Adressbereich des EEPROMS prüfen und address ggf. maskieren
-    write(LATCH_pin, 0);//digitalWrite(LATCH, LOW);
-    SPI.transfer16(address);
-    write(LATCH_pin, 1);//digitalWrite(LATCH, HIGH);
-    delayMicroseconds(1);
-    write(LATCH_pin, 0);
-}
-
-
-void eeprom_read_bytes_at(const uint16_t address, uint8_t *buf, const int len)
-{
-    int offset = 0;
-    
-    eeprom_set_data_in();
-    
-    while ( offset < len )
-    {
-        set(OE_pin | CE_pin);
-        eeprom_set_address(address + offset);
-        write(CE_pin, 0);
-        write(OE_pin, 0);
-        delayMicroseconds(3);   // Toe
-        buf[offset] = eeprom_data_in();
-        offset++;
-    }
-    set(OE_pin | CE_pin); 
-}
-
-
-void read_id() {
-    uint8_t id_byte1 = 0;
-    uint8_t id_byte2 = 0;
-
-    eeprom_set_data_in();
-    set(OE_pin | CE_pin);
-    eeprom_set_address(0);
-    enable_A9_HV();
-    delayMicroseconds(5);
-    write(CE_pin, 0);
-    
-    delayMicroseconds(5);
-    write(OE_pin, 0);
-    delayMicroseconds(5); // Toe
-    id_byte1 = eeprom_data_in();
-    write(OE_pin, 1);
-
-    eeprom_set_address(1);
-    delayMicroseconds(5);
-    write(OE_pin, 0);
-    delayMicroseconds(5); // Toe
-    id_byte2 = eeprom_data_in();
-    write(OE_pin, 1);
-    disable_A9_HV();
-    write(CE_pin, 1);
-    Serial.print("ID = ");
-    Serial.print(id_byte1, HEX);
-    Serial.print(" / ");
-    Serial.println(id_byte2, HEX);
-}
-
-uint16_t read_id_new()
-{
-    uint8_t id_byte1 = 0;
-    uint8_t id_byte2 = 0;
-
-    uint8_t bl, bh;
-
-    eeprom_set_data_in();
-    set(OE_pin | CE_pin);
-    eeprom_set_address(0);
-    enable_A9_HV();
-    delayMicroseconds(5);
-    write(CE_pin, 0);
-
-    delayMicroseconds(3);
-    write(OE_pin, 0);
-    delayMicroseconds(3); // Toe
-    bl = read(DATA_low);
-    bh = read(DATA_high);
-    id_byte1 = eeprom_data_in();
-    set(OE_pin | CE_pin);
-    disable_A9_HV();
-    
-    delayMicroseconds(100);
-    eeprom_set_address(1);
-    enable_A9_HV();
-    delayMicroseconds(5);
-    write(CE_pin, 0);
-    delayMicroseconds(3);
-    write(OE_pin, 0);
-    delayMicroseconds(3); // Toe
-    id_byte2 = eeprom_data_in();
-    set(OE_pin | CE_pin); 
-    delayMicroseconds(3);                       // feste Verzoegerung ca. 500 ns einbauen (mit cli)
-    disable_A9_HV();
-    Serial.println(bl, HEX);
-    Serial.println(bh,HEX);
-    return  (id_byte2 + (id_byte1 << 8));
-}
-
-void erase()
-{
-    eeprom_set_data_in();
-    set(OE_pin | CE_pin);
-    eeprom_set_address(0);
-    enable_A9_HV();
-    enable_OE_VPP();
-    delayMicroseconds(5);   //Toes OE/VPP setup time, min 2us
-    write(CE_pin, 0);
-    delay(100);             // Tpwe erase puls width (95...105 ms)
-    write(CE_pin, 1);
-    delayMicroseconds(5);   // Toeh
-    disable_OE_VPP();       // OE bleibt H
-    disable_A9_HV();
-}
-
-bool blank_check(uint16_t max_address, uint16_t *adr_fail)
-{
-    uint16_t address = 0;
-    uint8_t b = 0;
-    
-    eeprom_set_data_in();
-
-    do {
-        set(OE_pin | CE_pin);
-        eeprom_set_address(address);
-        write(CE_pin, 0);
-        write(OE_pin, 0);
-        delayMicroseconds(3); // Toe
-        if ( (b = eeprom_data_in()) != 0xFF ) 
-            break;
-    } while ( address++ < max_address );
-    set(OE_pin | CE_pin);
-    if ( b != 0xFF ) {
-        if ( adr_fail )
-            *adr_fail = address;
-        return false;
-    }
-    return true;
-}
-
-bool program( uint16_t address, uint8_t *buf, int len)
-{
-    int offset = 0;
-    uint8_t b = 0xFF;
-    int loops = 0;
-    
-    set(OE_pin | CE_pin);
-    eeprom_set_data_out(); 
-    enable_OE_VPP();    
-    do
-    {
-        eeprom_set_address(address + offset);
-        delayMicroseconds(3);       // Tds
-        eeprom_data_out(buf[offset]);
-        delayMicroseconds(5);       // Tas
-        write(CE_pin, 0);
-// AP 95 bei EEPROM, 1000 bei EPROM
-        delayMicroseconds(1000);     // Tpwp (funktioniert auch mit 5 us!)
-        write(CE_pin, 1);
-        delayMicroseconds(3);       // Tdh / Tah / Toeh
-             //verify
-            write(OE_pin, 0);
-delayMicroseconds(3);
-            eeprom_set_data_in();
-            disable_OE_VPP();
-delayMicroseconds(3);
-            write(CE_pin, 0);
-            delayMicroseconds(30);      // Tdv1 30
-            b = eeprom_data_in();
-            set(OE_pin | CE_pin);
-delayMicroseconds(3);
-            enable_OE_VPP();
-            delayMicroseconds(5);
-            eeprom_set_data_out();
-            //Serial.print(b != buf[offset] ? "-" : "+"); 
-        if ( b != buf[offset] ) 
-            loops++;
-        else {
-            offset++;
-            loops = 0;
-        }   
-    } while (offset < len && loops < 20 );
-    set(OE_pin | CE_pin);
-    disable_OE_VPP();
-    eeprom_set_data_in();
-    return (loops == 0); 
-}
-
-int32_t programFile(const char *path, uint16_t adr)
-{
-    uint32_t file_size;
-    int32_t bytes_written = 0;
-    //Serial.println(path);
-    if (!SD.exists(const_cast<char *>(path)))
-        return -1;
-
-    File f = SD.open(path);
-    //Serial.println(f.size());
-
-    if (!f)
-        return -2;
-    file_size = f.size();
-    if ( (file_size + adr-1 ) > 0x0000FFFF )
-    {
-        f.close();
-        return -3;
-    }
-    Serial.print("File: ");
-    Serial.print(path);
-    Serial.print(" / Size: ");
-    Serial.println(file_size);
-    // f.seek(0);
-    Serial.print("Programming ... ");
-    while (f.available())
-    {
-        size_t bytes_readed = f.readBytes(buffer, sizeof(buffer));
-        if (bytes_readed)
-        {
-            if (program(adr, buffer, bytes_readed))
-            {
-                Serial.print("#");
-                adr += bytes_readed;
-                bytes_written += bytes_readed;
-            }
-            else
-            {
-                f.close();
-                return -4;
-            }
-        }
-    }
-    Serial.println();
-    Serial.print(bytes_written);
-    Serial.println(" bytes written");
-    f.close();
-    return bytes_written;
-}
-
-// ToDo
-bool confirmation()
-{
-    // confirmation_needed = true;
-    // Serial.print("Confirm [y/N]? ");
-    // while ( confirmation_needed ); 
-    // Serial.println();
-    // return confirmation_given;
-    return false;
-}
-
-void setup()
-{
-    inputString.reserve(20);
-    memset(buffer, 0x55, sizeof(buffer));
-
-    // initialize serial
-    Serial.begin(115200);
-    while ( !Serial );
-
-    eeprom_init_pins();
-    eeprom_set_data_in();
-    
-    Serial.println("EEPrommer V0");   
-    SPI.begin();
-
-    if ( !SD.begin(SS) )
-        Serial.println("SD Init fail");
-
-
-}
-
-// the loop function runs over and over again forever
-void loop()
-{
-    static uint16_t adr = 0;
-    static uint16_t nextAdr = 0;
-    
-    if ( inputAvailable ) {
-        //Serial.println(inputString);
-        inputString.trim();
-    // todo: Leerzeichen zu Parametern überlesen
-    // read kann adresse als Argument übernehmen
-    // fill Befehl
-        switch (inputString[0]) {
-            case 'a':
-            case 'A': 
-            // to do aktuelle adresse (start der letzten r,n anweisung) anzeigen, wenn keine Zahl eingegeben wurde
-                if (inputString[1] != '#' )     // # dezimal, sonst Hex
-                    nextAdr = adr = strtoul(inputString.substring(1).c_str(), 0, 16);
-                else
-                    nextAdr = adr = inputString.substring(2).toInt();
-                Serial.print("Adresse (hex) = "); Serial.println(adr, HEX);
-                break;
-            case 'h':
-            case 'H':
-                Serial.println(adr, HEX);
-                hexDump("dump", buffer, adr, sizeof(buffer));
-                break;
-            case 'e':
-            case 'E':
-                Serial.print("Erasing...");
-                erase();
-                if ( !blank_check(0xFFFF, 0) )
-                    Serial.println (" failed");
-                else 
-                    Serial.println(" ok");
-            break;
-            case 'i':
-                Serial.print("ID = ");
-                //Serial.println(read_id_new(), HEX);
-                read_id();
-                break;
-            case 'r':
-                eeprom_read_bytes_at(adr, buffer, sizeof(buffer));
-                hexDump("read", buffer, adr, sizeof(buffer));
-                nextAdr = adr + sizeof(buffer);
-                break;
-            case 'n':
-                eeprom_read_bytes_at(nextAdr, buffer, sizeof(buffer));
-                hexDump("next read", buffer, nextAdr, sizeof(buffer));
-                nextAdr += sizeof(buffer);
-                break;
-            case 'p':
-                hexDump("buffer", buffer, 0, sizeof(buffer));
-                Serial.print("Programming at "); Serial.println(adr, HEX);
-                if ( !program(adr, buffer, sizeof(buffer)) )
-                    Serial.println("programming fails");
-                break;
-            case 'b':
-                uint16_t fail;
-                Serial.print("Blank check ");
-                if ( blank_check(0xFFFF, &fail) )
-                    Serial.println("ok!");
-                else {
-                    Serial.print("failed on address ");
-                    Serial.println(fail, HEX);
-                } 
-                break;
-            case 'f':
-                int rc;
-                 rc = programFile(inputString.substring(1).c_str(), adr);
-                
-                if ( rc < 0 ) {
-                    Serial.print("return code = "); 
-                    Serial.println(rc);
-                }
-                break;
-            default:
-                Serial.println("?");
-        } 
-        inputString = "";
-        inputAvailable = false;
-    }
-}
-
-
-void serialEvent()
-{
-    int len;
-    char inChar;
-    if (confirmation_needed) {
-        Serial.flush();
-        if ( Serial.available() ) {
-            inChar = (char)Serial.read();
-        }
-        confirmation_given = (inChar == 'y' || inChar == 'Y');
-        confirmation_needed = false;
-    }
-    else 
-        while (Serial.available() && !inputAvailable)
-        {
-            inChar = (char)Serial.read();
-            // Serial.println(int(inChar));
-            switch (inChar) {
-                case '\n':
-                    inputAvailable = true;
-                    break;
-                case '\b':
-                    if ( (len = inputString.length()) > 0 )
-                        inputString.remove(len-1);
-                        // fall thru 
-                case '\r':  
-                    break;
-                default:
-                    inputString += inChar;
-            } 
-        }
-}
-
-
-void hexDump(const char *desc, void *addr, unsigned int offset, int len)
-{
-    int i;
-    unsigned char ascii_buffer[17]; // ASCII Block
-    char sprintfbuffer[14];
-    unsigned char *pc = (unsigned char *)addr;
-
-    if (len == 0)
-        return;
-    // Output description if given.
-    if (desc != NULL) {
-        Serial.print(desc); Serial.println(":");
-    }
-    // Process every byte in the data.
-    for (i = 0; i < len; i++) {
-        // Multiple of 16 means new line (with line offset).
-
-        if ((i % 16) == 0) {
-            // Just don't print ASCII for the zeroth line.
-            if (i != 0) {
-                Serial.print(" | ");
-                Serial.println((char *)ascii_buffer);
-            }
-            // Output the offset.
-            sprintf(sprintfbuffer, "  0x%08X ", offset);
-            Serial.print(sprintfbuffer);
-            offset += 16;
-        }
- 
-        // Now the hex code for the specific character.
-        sprintf(sprintfbuffer, " %02x", pc[i]);
-        Serial.print(sprintfbuffer);
-
-        // And store a printable ASCII character for later.
-        if ((pc[i] < 0x20) || (pc[i] > 0x7e))
-            ascii_buffer[i % 16] = '.';
-        else
-            ascii_buffer[i % 16] = pc[i];
-        ascii_buffer[(i % 16) + 1] = '\0';
-    }
-
-    // Pad out last line if not exactly 16 characters.
-    while ((i % 16) != 0) {
-        Serial.print("   ");
-        i++;
-    }
-
-    // And print the final ASCII bit.
-    Serial.print(" | ");
-    Serial.println((char *)ascii_buffer);
-}
+/*
+* This code assumes following pin layout for the Arduino Nano V3:
+
+* +--------+--------+----------+----------------------+----------+------+
+* |Name    |GPIO    |Signal    |Funktionsbaustein     |Direction | init |
+* +--------+--------+----------+----------------------+----------+------+
+* | D0     | PD0    | Rx       | UART                 | I        |      |
+* | D1     | PD1    | Tx       | UART                 | O        |      |
+* | D2     | PD2    | CE       | EEPROM               | O        |   H  |
+* | D3     | PD3    | A9_VPE   | EEPROM               | O        |   L  |
+* | D4     | PD4    | OE       | EEPROM               | O        |   H  |
+* | D5     | PD5    | OE_VPP   | EEPROM               | O        |   L  |
+* | D6     | PD6    | Data_6   | EEPROM               | I/O      |      |
+* | D7     | PD7    | Data_7   | EEPROM               | I/O      |      |
+* | D8     | PB0    | VPP_VPE  | Umschaltung VPP-VPE  | O        |   L  |
+* | D9     | PB1    | LATCH    | Latch_595            | O        |   H  |
+* | D10    | PB2    | SS       | SD_CS                | O        |   H  |
+* | D11    | PB3    | MOSI     | SD_MOSI / Data_595   | O        |      |
+* | D12    | PB4    | MISO     | SD_Miso              | I        |      |
+* | D13    | PB5    | SCK      | SD_CLK / Clock_|595  | O        |      |
+* | A0     | PC0    | Data_0   | EEPROM               | I/O      |      |
+* | A1     | PC1    | Data_1   | EEPROM               | I/O      |      |
+* | A2     | PC2    | Data_2   | EEPROM               | I/O      |      |
+* | A3     | PC3    | Data_3   | EEPROM               | I/O      |      |
+* | A4     | PC4    | Data_4   | EEPROM               | I/O      |      |
+* | A5     | PC5    | Data_5   | EEPROM               | I/O      |      |
+* +--------+--------+----------+----------------------+----------+------+
+*/
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <util/delay_basic.h>
+#include <SPI.h>
+#include <SD.h>
+
+#include "pin_definitions.hpp"
+#include "frame.h"
+#include "checksum.h"
+#include "hexfile.h"
+#include "unpack.h"
+#include "command.h"
+#include "usart.h"
+
+uint8_t buffer[256];
+uint8_t stream_buffer[256];     // second block buffer for programming from the serial stream
+
+// called repeatedly while a program pulse or a long read runs, e.g. to keep draining the serial
+// receiver while programming from the serial stream
+void (*eeprom_background)() = 0;
+
+const unsigned long console_baud = 115200;
+unsigned long serial_baud = console_baud;
+bool binary_mode = false;
+
+bool confirmation_needed = false;
+bool confirmation_given = false;
+int32_t run_script(const char *path);
+bool check_rc(int32_t rc);
+void hexDump(const __FlashStringHelper *desc, void *addr, uint32_t offset, int len);
+
+DECLARE_PIN (CE_pin, D, 2)
+DECLARE_PIN (A9_VPE_pin, D, 3)
+DECLARE_PIN (OE_pin, D, 4)
+DECLARE_PIN (OE_VPP_pin, D, 5)
+DECLARE_PIN (VPP_VPE_pin, B, 0)
+DECLARE_PIN (LATCH_pin, B, 1)
+DECLARE_PIN (SS_pin, B, 2)
+DECLARE_PIN_GROUP (DATA_low, C, 0, 6)
+DECLARE_PIN_GROUP (DATA_high, D, 6, 2)
+
+// how the socket pins of a chip family are wired to the latch outputs, see the map_ structs
+enum device_family {
+    FAMILY_27C512,          // A15 on pin 1, VPP on OE
+    FAMILY_27C256,          // VPP on pin 1
+    FAMILY_28C256,          // A14 on pin 1, /WE on pin 27 (the A14 output)
+    FAMILY_27C010           // 27C010/020/040 in the 32 pin adapter, A16..A18 from the third 595
+};
+
+enum erase_method {
+    ERASE_UV,               // UV eraser only
+    ERASE_A9_VPE,           // electrical chip erase with VPE on A9 and OE/VPP
+    ERASE_NOT_NEEDED        // EEPROM: bits go back to 1 when a byte is written
+};
+
+enum write_method {
+    WRITE_NONE,             // cannot be programmed in this socket
+    WRITE_PULSE,            // VPP on OE/VPP, one CE pulse per byte
+    WRITE_PAGE              // 5 V page write, end of the write cycle by DATA polling
+};
+
+/// programming parameters of a chip type, selected by the ID that read_id() returns or by
+/// name with the device command
+struct device_profile
+{
+    uint16_t id;            // manufacturer code << 8 | device code, 0: no electronic ID
+    char     name[9];       // at most 8 characters, the base name of its TUN/CAL files
+    uint8_t  family;        // device_family
+    uint8_t  address_bits;
+    uint8_t  vpp_dv;        // programming voltage in 0.1 V (set on the board), 0: 5 V writes
+    uint8_t  erase;         // erase_method
+    uint8_t  write;         // write_method
+    uint8_t  page_size;     // WRITE_PAGE
+    uint16_t tpwp_us;       // program pulse width
+    uint8_t  toe_us;        // OE low to data valid
+    uint8_t  tdv_us;        // program to verify recovery (Tdv1)
+    uint8_t  erase_ms;      // erase pulse width, WRITE_PAGE: longest write cycle (tWC)
+    uint8_t  max_pulses;    // program pulses (page writes) per byte before a byte counts as failed
+    uint8_t  read_loops;    // latch to sample delay found by calibrate_read(), 0: not calibrated
+};
+
+const device_profile device_profiles[] PROGMEM = {
+    //  id      name        family         bits VPP  erase             write        page Tpwp Toe Tdv erase pulses read
+    { 0xDA08, "W27C512",  FAMILY_27C512, 16, 120, ERASE_A9_VPE,     WRITE_PULSE,  0,  100, 3, 30, 100, 20,  0 },
+    { 0x1E0D, "AT27C512", FAMILY_27C512, 16, 130, ERASE_UV,         WRITE_PULSE,  0,  100, 3, 30,   0, 25,  0 },
+    { 0x208D, "M27C256",  FAMILY_27C256, 15, 128, ERASE_UV,         WRITE_NONE,   0,  100, 3, 30,   0, 25,  0 },
+    { 0x1E8C, "AT27C256", FAMILY_27C256, 15, 130, ERASE_UV,         WRITE_NONE,   0,  100, 3, 30,   0, 25,  0 },
+    { 0x1E05, "AT27C010", FAMILY_27C010, 17, 130, ERASE_UV,         WRITE_PULSE,  0,  100, 3, 30,   0, 25,  0 },
+    { 0x1E86, "AT27C020", FAMILY_27C010, 18, 130, ERASE_UV,         WRITE_PULSE,  0,  100, 3, 30,   0, 25,  0 },
+    { 0x1E0B, "AT27C040", FAMILY_27C010, 19, 130, ERASE_UV,         WRITE_PULSE,  0,  100, 3, 30,   0, 25,  0 },
+    { 0x0000, "AT28C256", FAMILY_28C256, 15,   0, ERASE_NOT_NEEDED, WRITE_PAGE,  64,    0, 3,  0,  10,  3,  0 },
+    { 0x0000, "generic",  FAMILY_27C512, 16, 125, ERASE_A9_VPE,     WRITE_PULSE,  0, 1000, 3, 30, 100, 20,  0 }  // unknown ID, has to stay the last entry
+};
+
+device_profile profile;     // active profile, see eeprom_select_profile()
+
+const uint32_t latch_size = 0x1000000UL;    // addresses the three 595 can reach
+
+// bytes of the active device
+uint32_t device_size()
+{
+    return 1UL << profile.address_bits;
+}
+
+// true if have can become want only through an erase
+inline bool needs_erase(uint8_t have, uint8_t want)
+{
+    return (have & want) != want && profile.erase != ERASE_NOT_NEEDED;
+}
+
+void enable_A9_HV()
+{
+    write(A9_VPE_pin, 1);
+}
+void disable_A9_HV()
+{
+    write(A9_VPE_pin, 0);
+}
+
+void enable_OE_VPP()
+{
+    write(OE_VPP_pin, 1);
+    //write(OE_pin, 1);
+}
+void disable_OE_VPP()
+{
+    write(OE_VPP_pin, 0);
+    //write(OE_pin, 0);
+}
+
+void eeprom_init_pins()
+{
+    set(CE_pin | OE_pin | LATCH_pin );     // sicherstellen, dass Ausgaenge HIGH sind
+    reset(A9_VPE_pin | OE_VPP_pin | VPP_VPE_pin);   // sicherstellen, dass Ausgaenge LOW sind
+    init_as_output(CE_pin | OE_pin |  LATCH_pin | A9_VPE_pin | OE_VPP_pin | VPP_VPE_pin);
+}
+void eeprom_output_enable() { 
+    write(OE_pin, 0); 
+}
+void eeprom_output_disable() { 
+    write(OE_pin, 1); 
+    delayMicroseconds(1); 
+}
+void eeprom_chip_select() { 
+    write(CE_pin, 0); 
+}
+void eeprom_chip_deselect() { 
+    write(CE_pin, 1); 
+    delayMicroseconds(1); 
+}
+void eeprom_set_data_out() { 
+    make_output(DATA_low);  
+    make_output(DATA_high); 
+}
+void eeprom_set_data_in() { // ohne pullup
+    //make_input_with_pull_ups(DATA_low);
+    //make_input_with_pull_ups(DATA_high); 
+    make_input_without_pull_ups(DATA_low);
+    make_input_without_pull_ups(DATA_high); 
+}
+
+uint8_t eeprom_data_in() 
+{ 
+    return read(DATA_low) + (read(DATA_high) << DATA_high.shift); 
+}
+
+void eeprom_data_out(uint8_t byte) { 
+    write(DATA_low, byte & DATA_low.mask );     // mask = 0x3F, shift = 0
+    write(DATA_high, byte >> DATA_high.shift);  // mask = 0xC0, shift = 6
+}
+
+// Latch outputs for a chip address: output n drives pin An of a 27C512. One struct per
+// family, the read engine is instantiated for each so the mapping is free inside its loop.
+// The third 595 (A16..A23) is the last one in the chain and only wired to the 32 pin
+// adapter. Shifting two bytes leaves the previous middle byte in it, which nothing on the
+// 28 pin socket sees, so 28 pin maps shift only bytes = 2.
+struct map_27c512
+{
+    typedef uint16_t pins_type;
+    static const uint8_t bytes = 2;
+    static inline pins_type latch(uint32_t address) { return address; }
+};
+
+// pin 1 is VPP, held at the 5 V read level by the A15 output
+struct map_27c256
+{
+    typedef uint16_t pins_type;
+    static const uint8_t bytes = 2;
+    static inline pins_type latch(uint32_t address) { return address | 0x8000; }
+};
+
+// pin 1 is A14; pin 27 (A14 output) is /WE and stays high except for the load strobes
+struct map_28c256
+{
+    typedef uint16_t pins_type;
+    static const uint8_t bytes = 2;
+    static const uint16_t we_high = 0x4000;
+    static inline pins_type latch(uint32_t address)
+    {
+        return (address & 0x3FFF) | ((address & 0x4000) << 1) | we_high;
+    }
+};
+
+// 32 pin adapter: A0..A15 as on a 27C512, A16..A18 from the third 595
+struct map_27c010
+{
+    typedef uint32_t pins_type;
+    static const uint8_t bytes = 3;
+    static inline pins_type latch(uint32_t address) { return address; }
+};
+
+// Gang board: up to gang_max_sockets 27C512 sockets on the shared latch and data bus. A fourth
+// 595 at the end of the chain drives their CE lines (low: selected). Its output enable is
+// wired to CE and the CE lines have pull-ups, so a socket sees CE low only while CE is low
+// and its output selects it. Program pulses and the erase may select several sockets,
+// reads select exactly one.
+const uint8_t gang_max_sockets = 4;
+uint8_t gang_sockets = 0;       // sockets on the gang board, 0: single socket on CE
+uint8_t gang_socket = 0;        // socket of the single chip commands (r, v, d, p, checksum ...)
+uint8_t gang_select = 1;        // sockets selected by the next latch, bit n: socket n
+
+struct map_gang
+{
+    typedef uint32_t pins_type;
+    static const uint8_t bytes = 4;
+    static inline pins_type latch(uint32_t address)
+    {
+        return (uint32_t)(uint8_t)~gang_select << 24 | (address & 0xFFFF);
+    }
+};
+
+inline uint8_t socket_count() { return gang_sockets ? gang_sockets : 1; }
+
+// latch outputs for address on the active device
+uint32_t eeprom_latch_pins(uint32_t address)
+{
+    if ( gang_sockets )
+        return map_gang::latch(address);
+    switch ( profile.family ) {
+        case FAMILY_27C256:
+            return map_27c256::latch(address);
+        case FAMILY_28C256:
+            return map_28c256::latch(address);
+        case FAMILY_27C010:
+            return map_27c010::latch(address);
+        default:
+            return map_27c512::latch(address);
+    }
+}
+
+// clock the latch outputs for address into the 595 shift stages; the chip sees them only
+// after the next rising edge of LATCH
+void eeprom_shift_address(uint32_t address)
+{
+    uint32_t pins = eeprom_latch_pins(address);
+
+    if ( gang_sockets )
+        SPI.transfer(pins >> 24);
+    if ( gang_sockets || profile.family == FAMILY_27C010 )
+        SPI.transfer(pins >> 16);
+    SPI.transfer16(pins);
+}
+
+void eeprom_set_address(uint32_t address)
+{
+    write(LATCH_pin, 0);//digitalWrite(LATCH, LOW);
+    eeprom_shift_address(address);
+    write(LATCH_pin, 1);//digitalWrite(LATCH, HIGH);
+    delayMicroseconds(1);
+    write(LATCH_pin, 0);
+}
+
+
+// 595 shift clock for the fast read engine (SCK max. 8 MHz on the Nano)
+const SPISettings eeprom_address_spi(8000000, MSBFIRST, SPI_MODE0);
+
+inline void eeprom_spi_wait()
+{
+    while ( !(SPSR & _BV(SPIF)) )
+        ;
+}
+
+inline void eeprom_latch_address()
+{
+    write(LATCH_pin, 1);
+    write(LATCH_pin, 0);
+}
+
+// shift the bytes of a latch value that are sent before the last one
+template <typename map_type>
+inline void eeprom_shift_high(typename map_type::pins_type pins)
+{
+    if ( map_type::bytes > 3 ) {
+        SPDR = pins >> 24;
+        eeprom_spi_wait();
+    }
+    if ( map_type::bytes > 2 ) {
+        SPDR = pins >> 16;
+        eeprom_spi_wait();
+    }
+    SPDR = pins >> 8;
+    eeprom_spi_wait();
+}
+
+const uint8_t read_loops_per_spi_byte = 5;     // an SPI byte at 8 MHz takes at least 16 cycles
+
+// read delay in ns for loops counts of _delay_loop_1()
+uint16_t read_loops_ns(uint8_t loops)
+{
+    return loops * 3000UL / clockCyclesPerMicrosecond();
+}
+
+// wait until the byte of the address just latched is valid: the calibrated delay, else Toe
+inline void eeprom_read_settle()
+{
+    if ( profile.read_loops )
+        _delay_loop_1(profile.read_loops);
+    else
+        delayMicroseconds(profile.toe_us);
+}
+
+/// Pipelined sequential read of the addresses first..last (inclusive).
+/// CE and OE stay low for the whole range. While byte N settles, address N+1 is clocked into
+/// the shift register of the 595 by direct SPDR writes; it is moved to the 595 outputs as soon
+/// as byte N has been sampled. The shift of the high address bytes covers Toe/Tacc; only a
+/// calibrated delay (profile.read_loops) longer than that adds a wait before the sample.
+/// sink(address, byte) is called for every byte; the read stops early when it returns false.
+/// map_type turns chip addresses into latch outputs. Returns true if the whole range was read.
+template <typename map_type, typename sink_type>
+bool eeprom_read_sequential(uint32_t first, uint32_t last, sink_type &sink)
+{
+    uint32_t address = first;
+    typename map_type::pins_type pins = map_type::latch(address);
+    bool complete = true;
+    uint8_t shift_loops = (map_type::bytes - 1) * read_loops_per_spi_byte;
+    uint8_t extra = profile.read_loops > shift_loops ? profile.read_loops - shift_loops : 0;
+
+    eeprom_set_data_in();
+    SPI.beginTransaction(eeprom_address_spi);
+    set(OE_pin | CE_pin);
+    eeprom_shift_high<map_type>(pins);
+    SPDR = pins;
+    eeprom_spi_wait();
+    eeprom_latch_address();
+    write(CE_pin, 0);
+    write(OE_pin, 0);
+
+    while ( address != last ) {
+        uint32_t next = address + 1;
+        pins = map_type::latch(next);
+        eeprom_shift_high<map_type>(pins);  // shift next address while the current byte settles
+        SPDR = pins;
+        if ( extra )
+            _delay_loop_1(extra);
+        if ( !sink(address, eeprom_data_in()) ) {
+            complete = false;
+            break;
+        }
+        eeprom_spi_wait();
+        eeprom_latch_address();
+        address = next;
+    }
+    if ( complete ) {
+        eeprom_read_settle();               // nothing left to overlap with for the last byte
+        complete = sink(address, eeprom_data_in());
+    }
+    else
+        eeprom_spi_wait();
+    set(OE_pin | CE_pin);
+    SPI.endTransaction();
+    return complete;
+}
+
+/// eeprom_read_sequential() with the address mapping of the active device
+template <typename sink_type>
+bool eeprom_read_range(uint32_t first, uint32_t last, sink_type &sink)
+{
+    if ( gang_sockets )
+        return eeprom_read_sequential<map_gang>(first, last, sink);
+    switch ( profile.family ) {
+        case FAMILY_27C256:
+            return eeprom_read_sequential<map_27c256>(first, last, sink);
+        case FAMILY_28C256:
+            return eeprom_read_sequential<map_28c256>(first, last, sink);
+        case FAMILY_27C010:
+            return eeprom_read_sequential<map_27c010>(first, last, sink);
+        default:
+            return eeprom_read_sequential<map_27c512>(first, last, sink);
+    }
+}
+
+// sinks for eeprom_read_range()
+struct read_to_buffer
+{
+    uint8_t *p;
+    bool operator()(uint32_t, uint8_t b) { *p++ = b; return true; }
+};
+
+struct check_blank
+{
+    uint32_t fail;
+    bool operator()(uint32_t address, uint8_t b)
+    {
+        if ( b == 0xFF )
+            return true;
+        fail = address;
+        return false;
+    }
+};
+
+void eeprom_read_bytes_at(const uint32_t address, uint8_t *buf, const int len)
+{
+    if ( len <= 0 )
+        return;
+    read_to_buffer sink = { buf };
+    eeprom_read_range(address, address + len - 1, sink);
+}
+
+
+// returns manufacturer code << 8 | device code
+uint16_t read_id() {
+    uint8_t id_byte1 = 0;
+    uint8_t id_byte2 = 0;
+
+    eeprom_set_data_in();
+    set(OE_pin | CE_pin);
+    eeprom_set_address(0);
+    enable_A9_HV();
+    delayMicroseconds(5);
+    write(CE_pin, 0);
+    
+    delayMicroseconds(5);
+    write(OE_pin, 0);
+    delayMicroseconds(5); // Toe
+    id_byte1 = eeprom_data_in();
+    write(OE_pin, 1);
+
+    eeprom_set_address(1);
+    delayMicroseconds(5);
+    write(OE_pin, 0);
+    delayMicroseconds(5); // Toe
+    id_byte2 = eeprom_data_in();
+    write(OE_pin, 1);
+    disable_A9_HV();
+    write(CE_pin, 1);
+    return id_byte2 + (id_byte1 << 8);
+}
+
+const uint8_t device_profile_count = sizeof(device_profiles) / sizeof(device_profiles[0]);
+
+// SD file with a tuning result for the active chip type, ext: TUN (autotune), CAL (read timing)
+void profile_file_name(char *path, size_t size, PGM_P ext)
+{
+    snprintf_P(path, size, PSTR("%s."), profile.name);
+    strncat_P(path, ext, size - strlen(path) - 1);
+}
+
+// number saved in a profile file, 0 without the file
+uint16_t profile_file_value(PGM_P ext)
+{
+    char path[13];
+    uint16_t value = 0;
+
+    profile_file_name(path, sizeof(path), ext);
+    File f = SD.open(path);
+    if ( f ) {
+        char text[8];
+        size_t len = f.readBytes(text, sizeof(text) - 1);
+        text[len] = 0;
+        value = strtoul(text, 0, 10);
+        f.close();
+    }
+    return value;
+}
+
+// replace a profile file by value, false if it cannot be written
+bool profile_file_save(PGM_P ext, uint16_t value)
+{
+    char path[13];
+
+    profile_file_name(path, sizeof(path), ext);
+    SD.remove(path);
+    File f = SD.open(path, FILE_WRITE);
+    if ( !f )
+        return false;
+    f.println(value);
+    f.close();
+    return true;
+}
+
+/// Make entry i of the profile table the active profile. A pulse width found by autotune and
+/// a read delay found by calibrate_read() for this chip type override the table.
+void eeprom_load_profile(uint8_t i)
+{
+    memcpy_P(&profile, &device_profiles[i], sizeof(profile));
+    if ( profile.family != FAMILY_27C512 || profile.write != WRITE_PULSE ) {
+        gang_sockets = 0;       // the gang board takes pulse programmed 27C512 only
+        gang_socket = 0;
+        gang_select = 1;
+    }
+    uint16_t us = profile_file_value(PSTR("TUN"));
+    if ( us > 0 && us <= profile.tpwp_us )
+        profile.tpwp_us = us;
+    uint16_t loops = profile_file_value(PSTR("CAL"));
+    if ( loops <= 0xFF )
+        profile.read_loops = loops;
+}
+
+/// Make the profile for id the active one; unknown IDs get the generic profile unless
+/// keep_unknown is set, then the active profile stays. Chips without an electronic ID (id 0
+/// in the table) are never found, they are selected by name. Returns true if id is known.
+bool eeprom_select_profile(uint16_t id, bool keep_unknown)
+{
+    uint8_t i;
+
+    for ( i = 0; i < device_profile_count - 1; i++ )
+        if ( pgm_read_word(&device_profiles[i].id) == id && id )
+            break;
+    if ( i == device_profile_count - 1 && keep_unknown )
+        return false;
+    eeprom_load_profile(i);
+    return i != device_profile_count - 1;
+}
+
+// device <name>: select a profile by name, case does not matter
+bool eeprom_select_profile_by_name(const char *name)
+{
+    for ( uint8_t i = 0; i < device_profile_count; i++ ) {
+        if ( !strcasecmp_P(name, device_profiles[i].name) ) {
+            eeprom_load_profile(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void print_profile()
+{
+    Serial.print(profile.name);
+    Serial.print(F(": "));
+    Serial.print(device_size() >> 10);
+    Serial.print(F(" KB, "));
+    if ( profile.read_loops ) {
+        Serial.print(F("read "));
+        Serial.print(read_loops_ns(profile.read_loops));
+        Serial.print(F(" ns, "));
+    }
+    if ( profile.write == WRITE_PAGE ) {
+        Serial.print(profile.page_size);
+        Serial.print(F(" byte pages, tWC "));
+        Serial.print(profile.erase_ms);
+        Serial.println(F(" ms"));
+        return;
+    }
+    if ( profile.write == WRITE_NONE )
+        Serial.print(F("read only, "));
+    Serial.print(F("VPP "));
+    Serial.print(profile.vpp_dv / 10);
+    Serial.print('.');
+    Serial.print(profile.vpp_dv % 10);
+    Serial.print(F(" V, Tpwp "));
+    Serial.print(profile.tpwp_us);
+    Serial.print(F(" us, Toe "));
+    Serial.print(profile.toe_us);
+    Serial.print(F(" us, Tdv "));
+    Serial.print(profile.tdv_us);
+    if ( profile.erase == ERASE_A9_VPE ) {
+        Serial.print(F(" us, erase "));
+        Serial.print(profile.erase_ms);
+        Serial.print(F(" ms"));
+    }
+    else
+        Serial.print(F(" us, UV erase"));
+    Serial.print(F(", max. "));
+    Serial.print(profile.max_pulses);
+    Serial.println(F(" pulses"));
+}
+
+uint16_t read_id_new()
+{
+    uint8_t id_byte1 = 0;
+    uint8_t id_byte2 = 0;
+
+    uint8_t bl, bh;
+
+    eeprom_set_data_in();
+    set(OE_pin | CE_pin);
+    eeprom_set_address(0);
+    enable_A9_HV();
+    delayMicroseconds(5);
+    write(CE_pin, 0);
+
+    delayMicroseconds(3);
+    write(OE_pin, 0);
+    delayMicroseconds(3); // Toe
+    bl = read(DATA_low);
+    bh = read(DATA_high);
+    id_byte1 = eeprom_data_in();
+    set(OE_pin | CE_pin);
+    disable_A9_HV();
+    
+    delayMicroseconds(100);
+    eeprom_set_address(1);
+    enable_A9_HV();
+    delayMicroseconds(5);
+    write(CE_pin, 0);
+    delayMicroseconds(3);
+    write(OE_pin, 0);
+    delayMicroseconds(3); // Toe
+    id_byte2 = eeprom_data_in();
+    set(OE_pin | CE_pin); 
+    delayMicroseconds(3);                       // feste Verzoegerung ca. 500 ns einbauen (mit cli)
+    disable_A9_HV();
+    Serial.println(bl, HEX);
+    Serial.println(bh,HEX);
+    return  (id_byte2 + (id_byte1 << 8));
+}
+
+// start of a chip erase pulse with VPE on A9 and OE/VPP (ERASE_A9_VPE), see erase_end()
+void erase_begin()
+{
+    eeprom_set_data_in();
+    set(OE_pin | CE_pin);
+    eeprom_set_address(0);
+    enable_A9_HV();
+    enable_OE_VPP();
+    delayMicroseconds(5);   //Toes OE/VPP setup time, min 2us
+    write(CE_pin, 0);
+}
+
+// ends the erase pulse after Tpwe (erase puls width 95...105 ms)
+void erase_end()
+{
+    write(CE_pin, 1);
+    delayMicroseconds(5);   // Toeh
+    disable_OE_VPP();       // OE bleibt H
+    disable_A9_HV();
+}
+
+// Program pulses are timed by Timer1: eeprom_pulse_start() pulls CE low and starts the timer,
+// the compare match interrupt pulls it high again. The pulse width does not depend on what
+// the CPU does meanwhile. Nothing may write PORTD (CE, D6/D7) while a pulse runs.
+ISR(TIMER1_COMPA_vect)
+{
+    set(CE_pin);
+    TCCR1B = 0;                 // stop Timer1, this also marks the end of the pulse
+}
+
+// start a program pulse of us; address and data have to be set up already
+void eeprom_pulse_start(uint16_t us)
+{
+    uint8_t clock = _BV(CS11);              // clk/8: 0.5 us per count
+    uint16_t counts = us * 2;
+
+    if ( us >= 0x8000 ) {
+        clock = _BV(CS11) | _BV(CS10);      // clk/64: 4 us per count
+        counts = us / 4;
+    }
+    TCCR1B = 0;
+    TCCR1A = 0;                 // normal mode, the Arduino core sets Timer1 up for PWM
+    TCNT1 = 0;
+    OCR1A = counts;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 = _BV(OCIE1A);
+    cli();
+    write(CE_pin, 0);
+    TCCR1B = clock;
+    sei();
+}
+
+// wait for the end of the program pulse, doing background work meanwhile
+void eeprom_pulse_wait()
+{
+    while ( TCCR1B )
+        if ( eeprom_background )
+            eeprom_background();
+}
+
+// bit i of a block bitmap stands for the byte at offset i
+inline bool bitmap_get(const uint8_t *map, uint8_t i) { return map[i >> 3] & (1 << (i & 7)); }
+inline void bitmap_set(uint8_t *map, uint8_t i) { map[i >> 3] |= 1 << (i & 7); }
+inline void bitmap_clear(uint8_t *map, uint8_t i) { map[i >> 3] &= ~(1 << (i & 7)); }
+
+struct program_result
+{
+    uint16_t failed;        // bytes that did not verify
+    uint16_t pulses;        // program pulses applied
+    uint8_t  rounds;        // pulse/verify rounds
+    uint8_t  fail_map[32];  // bitmap of the bytes that did not verify
+};
+
+// Programming statistics for the stats command: the pulses (write cycles of an EEPROM) every
+// byte needed, the bytes that needed the most and where the time went. Cleared by
+// "stats reset" and at the start of every f job.
+const uint8_t stats_buckets = 8;        // bytes that needed 1..7 pulses, 8 and more
+const uint8_t stats_worst = 4;          // length of the list of the worst bytes
+const uint8_t stats_failed = 0xFF;      // pulse count of a byte that did not verify
+
+struct program_stats
+{
+    uint32_t verified;                      // bytes programmed and verified
+    uint32_t failed;
+    uint32_t histogram[stats_buckets];      // verified bytes by the pulses they needed
+    uint32_t worst_address[stats_worst];    // most pulses first
+    uint8_t  worst_pulses[stats_worst];
+    uint32_t pulse_us;                      // address, data, pulse and hold time
+    uint32_t verify_us;                     // reading back, including the first compare
+    uint32_t switch_us;                     // VPP on and off, data bus direction
+};
+
+program_stats prog_stats;
+char stats_csv[13];                     // "stats csv": file that gets a row per f job
+
+// a programmed byte needed pulses pulses, or did not verify (stats_failed)
+void stats_record(uint32_t address, uint8_t pulses)
+{
+    if ( pulses == stats_failed )
+        prog_stats.failed++;
+    else {
+        prog_stats.verified++;
+        prog_stats.histogram[pulses < stats_buckets ? pulses - 1 : stats_buckets - 1]++;
+    }
+    for ( uint8_t i = 0; i < stats_worst; i++ ) {
+        if ( pulses <= prog_stats.worst_pulses[i] )
+            continue;
+        uint8_t move = stats_worst - 1 - i;
+        memmove(&prog_stats.worst_address[i + 1], &prog_stats.worst_address[i], move * sizeof(uint32_t));
+        memmove(&prog_stats.worst_pulses[i + 1], &prog_stats.worst_pulses[i], move);
+        prog_stats.worst_address[i] = address;
+        prog_stats.worst_pulses[i] = pulses;
+        return;
+    }
+}
+
+// record the bytes of a block that were pending before a read back and verified in it
+void stats_verified(uint32_t address, const uint8_t *before, const uint8_t *after,
+                    uint16_t lo, uint16_t hi, uint8_t pulses)
+{
+    for ( uint16_t i = lo; i <= hi; i++ )
+        if ( bitmap_get(before, i) && !bitmap_get(after, i) )
+            stats_record(address + i, pulses);
+}
+
+// add the time since t to bucket and restart t
+void stats_lap(uint32_t &bucket, unsigned long &t)
+{
+    unsigned long now = micros();
+    bucket += now - t;
+    t = now;
+}
+
+// stats: the histogram, the worst bytes and the time split
+void print_stats()
+{
+    Serial.print(prog_stats.verified);
+    Serial.print(F(" bytes verified, "));
+    Serial.print(prog_stats.failed);
+    Serial.println(F(" failed"));
+    Serial.print(F("pulses per byte:"));
+    for ( uint8_t i = 0; i < stats_buckets; i++ ) {
+        Serial.print(' ');
+        Serial.print(i + 1);
+        Serial.print(i + 1 < stats_buckets ? F(":") : F("+:"));
+        Serial.print(prog_stats.histogram[i]);
+    }
+    Serial.println();
+    Serial.print(F("worst:"));
+    for ( uint8_t i = 0; i < stats_worst && prog_stats.worst_pulses[i]; i++ ) {
+        Serial.print(' ');
+        Serial.print(prog_stats.worst_address[i], HEX);
+        Serial.print(F(" ("));
+        if ( prog_stats.worst_pulses[i] == stats_failed )
+            Serial.print(F("failed"));
+        else
+            Serial.print(prog_stats.worst_pulses[i]);
+        Serial.print(')');
+    }
+    Serial.println();
+    Serial.print(F("time: pulse "));
+    Serial.print(prog_stats.pulse_us / 1000);
+    Serial.print(F(" ms, verify "));
+    Serial.print(prog_stats.verify_us / 1000);
+    Serial.print(F(" ms, switch "));
+    Serial.print(prog_stats.switch_us / 1000);
+    Serial.println(F(" ms"));
+}
+
+/// Append the statistics of a burn of file with the result rc as a row to the stats_csv
+/// file; a new file gets a header line first. Returns false if the file can't be written.
+bool stats_append_csv(const char *file, int32_t rc)
+{
+    File f = SD.open(stats_csv, FILE_WRITE);
+
+    if ( !f )
+        return false;
+    if ( f.size() == 0 ) {
+        f.print(F("file,device,result,verified,failed"));
+        for ( uint8_t i = 0; i < stats_buckets; i++ ) {
+            f.print(F(",p"));
+            f.print(i + 1);
+            if ( i + 1 == stats_buckets )
+                f.print('+');
+        }
+        f.println(F(",pulse_ms,verify_ms,switch_ms,worst"));
+    }
+    f.print(file);
+    f.print(',');
+    f.print(profile.name);
+    f.print(',');
+    f.print(rc);
+    f.print(',');
+    f.print(prog_stats.verified);
+    f.print(',');
+    f.print(prog_stats.failed);
+    for ( uint8_t i = 0; i < stats_buckets; i++ ) {
+        f.print(',');
+        f.print(prog_stats.histogram[i]);
+    }
+    f.print(',');
+    f.print(prog_stats.pulse_us / 1000);
+    f.print(',');
+    f.print(prog_stats.verify_us / 1000);
+    f.print(',');
+    f.print(prog_stats.switch_us / 1000);
+    f.print(',');
+    for ( uint8_t i = 0; i < stats_worst && prog_stats.worst_pulses[i]; i++ ) {
+        if ( i )
+            f.print(' ');
+        f.print(prog_stats.worst_address[i], HEX);
+        f.print(':');
+        if ( prog_stats.worst_pulses[i] == stats_failed )
+            f.print('F');
+        else
+            f.print(prog_stats.worst_pulses[i]);
+    }
+    f.println();
+    f.close();
+    return true;
+}
+
+// program mode: VPP on OE/VPP, the Nano drives the data bus
+void eeprom_program_mode()
+{
+    set(OE_pin | CE_pin);
+    eeprom_set_data_out();
+    enable_OE_VPP();
+    delayMicroseconds(5);       // Toes
+}
+
+// verify mode: VPP off, data bus released
+void eeprom_verify_mode()
+{
+    set(OE_pin | CE_pin);
+    eeprom_set_data_in();
+    disable_OE_VPP();
+    delayMicroseconds(profile.tdv_us);
+}
+
+// one program pulse of us, the chip has to be in program mode
+void eeprom_program_byte(uint32_t address, uint8_t b, uint16_t us)
+{
+    eeprom_set_address(address);
+    eeprom_data_out(b);
+    delayMicroseconds(5);       // Tas / Tds
+// AP 95 bei EEPROM, 1000 bei EPROM
+    eeprom_pulse_start(us);     // Tpwp (funktioniert auch mit 5 us!)
+    eeprom_pulse_wait();
+    delayMicroseconds(3);       // Tdh / Tah / Toeh
+}
+
+// eeprom_read_range() sink that compares a block with the wanted data
+struct verify_block
+{
+    uint32_t base;
+    const uint8_t *want;
+    uint8_t *pending;
+    uint8_t *fail_map;      // set on the first pass: sorts out bytes that need a 0 -> 1 change
+
+    bool operator()(uint32_t address, uint8_t b)
+    {
+        uint8_t i = address - base;
+        uint8_t w = want[i];
+        if ( b == w )
+            bitmap_clear(pending, i);
+        else if ( fail_map ) {
+            if ( !needs_erase(b, w) )
+                bitmap_set(pending, i);
+            else
+                bitmap_set(fail_map, i);    // only an erase can set bits
+        }
+        if ( eeprom_background )
+            eeprom_background();
+        return true;
+    }
+};
+
+// first byte at or after i that is still pending, last + 1 if there is none
+uint16_t next_pending(const uint8_t *pending, uint16_t i, uint16_t last)
+{
+    while ( i <= last && !bitmap_get(pending, i) )
+        i++;
+    return i;
+}
+
+/// Quick-pulse block programming of up to 256 bytes.
+/// A first read pass finds the bytes that differ. Then every byte that still differs gets one
+/// program pulse, the chip is switched to verify mode once and the pulsed range is read back
+/// in one pass. This repeats until all bytes verify or profile.max_pulses rounds are done.
+/// While a pulse runs the address of the next pending byte is shifted into the 595, so the
+/// next pulse can start right after the hold time.
+/// Returns the number of bytes that did not verify; r.fail_map tells which.
+int pulse_program_block(uint32_t address, const uint8_t *buf, uint16_t len, program_result &r)
+{
+    uint8_t pending[32], pulsed[32];
+    uint16_t first, last;
+    verify_block v = { address, buf, pending, r.fail_map };
+    unsigned long t = micros();
+
+    memset(&r, 0, sizeof(r));
+    memset(pending, 0, sizeof(pending));
+    if ( len == 0 || len > 256 )
+        return len;
+    first = 0;
+    last = len - 1;
+    eeprom_read_range(address, address + last, v);
+    v.fail_map = 0;
+    stats_lap(prog_stats.verify_us, t);
+
+    while ( r.rounds < profile.max_pulses ) {
+        uint16_t n = 0, lo = 0, hi = 0;
+        uint16_t i = next_pending(pending, first, last);
+        eeprom_program_mode();
+        stats_lap(prog_stats.switch_us, t);
+        if ( i <= last )
+            eeprom_set_address(address + i);
+        while ( i <= last ) {
+            eeprom_data_out(buf[i]);
+            delayMicroseconds(5);       // Tas / Tds
+            eeprom_pulse_start(profile.tpwp_us);
+            if ( !n++ )
+                lo = i;
+            hi = i;
+            i = next_pending(pending, i + 1, last);
+            if ( i <= last )
+                eeprom_shift_address(address + i);
+            eeprom_pulse_wait();
+            delayMicroseconds(3);       // Tdh / Tah
+            if ( i <= last )
+                eeprom_latch_address();
+        }
+        stats_lap(prog_stats.pulse_us, t);
+        eeprom_verify_mode();
+        stats_lap(prog_stats.switch_us, t);
+        if ( !n )
+            break;
+        r.pulses += n;
+        r.rounds++;
+        first = lo;
+        last = hi;
+        memcpy(pulsed, pending, sizeof(pulsed));
+        eeprom_read_range(address + first, address + last, v);
+        stats_verified(address, pulsed, pending, first, last, r.rounds);
+        stats_lap(prog_stats.verify_us, t);
+    }
+    for ( uint16_t i = 0; i < len; i++ ) {
+        if ( bitmap_get(pending, i) )
+            bitmap_set(r.fail_map, i);
+        if ( bitmap_get(r.fail_map, i) ) {
+            r.failed++;
+            stats_record(address + i, stats_failed);
+        }
+    }
+    return r.failed;
+}
+
+struct gang_result
+{
+    uint16_t pulses;                        // program pulses, one pulse for several sockets counts once
+    uint8_t  rounds;
+    uint16_t failed[gang_max_sockets];
+    uint8_t  pending[gang_max_sockets][32]; // bitmaps of the bytes that did not verify
+    uint8_t  pulsed[32];                    // scratch of gang_program_block()
+};
+
+// next byte at or after i that a socket in sockets still needs; mask gets those sockets
+uint16_t gang_next_pending(const gang_result &r, uint8_t sockets, uint16_t i, uint16_t len,
+                           uint8_t &mask)
+{
+    for ( ; i < len; i++ ) {
+        mask = 0;
+        for ( uint8_t n = 0; n < gang_sockets; n++ )
+            if ( (sockets >> n & 1) && bitmap_get(r.pending[n], i) )
+                mask |= 1 << n;
+        if ( mask )
+            break;
+    }
+    return i;
+}
+
+/// Quick-pulse programming of up to 256 bytes into the sockets of the gang board that are
+/// set in sockets. Each socket is read on its own; then every byte gets one pulse for all
+/// the sockets that still need it at the same time, and each socket is read back on its own.
+/// A socket whose bytes all verified is no longer selected in later rounds. Bytes that need
+/// an erase are pulsed until profile.max_pulses rounds are done and fail then.
+/// Returns the sockets with bytes that did not verify, r.failed and r.pending tell which.
+uint8_t gang_program_block(uint32_t address, const uint8_t *buf, uint16_t len, uint8_t sockets,
+                           gang_result &r)
+{
+    verify_block v = { address, buf, 0, 0 };
+    uint8_t failed = 0;
+    unsigned long t = micros();
+
+    memset(&r, 0, sizeof(r));
+    if ( len == 0 || len > 256 )
+        return sockets;
+    for ( uint8_t n = 0; n < gang_sockets; n++ ) {
+        if ( !(sockets >> n & 1) )
+            continue;
+        memset(r.pending[n], 0xFF, sizeof(r.pending[n]));
+        gang_select = 1 << n;
+        v.pending = r.pending[n];
+        eeprom_read_range(address, address + len - 1, v);
+    }
+    stats_lap(prog_stats.verify_us, t);
+
+    while ( r.rounds < profile.max_pulses ) {
+        uint16_t pulses = 0, lo = 0, hi = 0;
+        uint8_t mask, selected = 0;
+        uint16_t i = gang_next_pending(r, sockets, 0, len, mask);
+        eeprom_program_mode();
+        stats_lap(prog_stats.switch_us, t);
+        if ( i < len ) {
+            gang_select = mask;
+            eeprom_set_address(address + i);
+        }
+        while ( i < len ) {
+            eeprom_data_out(buf[i]);
+            delayMicroseconds(5);       // Tas / Tds
+            eeprom_pulse_start(profile.tpwp_us);
+            if ( !pulses++ )
+                lo = i;
+            hi = i;
+            selected |= mask;
+            i = gang_next_pending(r, sockets, i + 1, len, mask);
+            if ( i < len ) {
+                gang_select = mask;     // the select outputs change with the next latch
+                eeprom_shift_address(address + i);
+            }
+            eeprom_pulse_wait();
+            delayMicroseconds(3);       // Tdh / Tah
+            if ( i < len )
+                eeprom_latch_address();
+        }
+        stats_lap(prog_stats.pulse_us, t);
+        eeprom_verify_mode();
+        stats_lap(prog_stats.switch_us, t);
+        if ( !pulses )
+            break;
+        r.pulses += pulses;
+        r.rounds++;
+        for ( uint8_t n = 0; n < gang_sockets; n++ ) {
+            if ( !(selected >> n & 1) )
+                continue;
+            gang_select = 1 << n;
+            v.pending = r.pending[n];
+            memcpy(r.pulsed, r.pending[n], sizeof(r.pulsed));
+            eeprom_read_range(address + lo, address + hi, v);
+            stats_verified(address, r.pulsed, r.pending[n], lo, hi, r.rounds);
+        }
+        stats_lap(prog_stats.verify_us, t);
+    }
+    for ( uint8_t n = 0; n < gang_sockets; n++ ) {
+        if ( !(sockets >> n & 1) )
+            continue;
+        for ( uint16_t i = 0; i < len; i++ ) {
+            if ( bitmap_get(r.pending[n], i) ) {
+                r.failed[n]++;
+                stats_record(address + i, stats_failed);
+            }
+        }
+        if ( r.failed[n] )
+            failed |= 1 << n;
+    }
+    return failed;
+}
+
+// one byte load of a 28C256: /WE low latches the address, the rising edge takes the data
+void eeprom_load_byte(uint16_t address, uint8_t b)
+{
+    uint16_t pins = map_28c256::latch(address);
+
+    eeprom_data_out(b);
+    SPDR = (pins & ~map_28c256::we_high) >> 8;
+    eeprom_spi_wait();
+    SPDR = pins;
+    eeprom_spi_wait();
+    eeprom_latch_address();
+    SPDR = pins >> 8;
+    eeprom_spi_wait();
+    SPDR = pins;
+    eeprom_spi_wait();
+    eeprom_latch_address();
+}
+
+// byte load cycle time of the AT28C256: the write cycle starts this long after the last load,
+// a read does not end the load window before
+const uint8_t page_load_window_us = 150;
+
+/// Write cycle for one page: the software data protection sequence, then the pending bytes of
+/// buf[from..to] (all in the same page). After the load window (tBLC) has closed, bit 7 of the
+/// last byte reads inverted until the write cycle is done (DATA polling); polling earlier could
+/// see the old contents and load the next page into the same window. Returns the bytes loaded.
+uint16_t eeprom_write_page(uint16_t address, const uint8_t *buf, const uint8_t *pending,
+                           uint16_t from, uint16_t to)
+{
+    uint16_t n = 0, last = 0;
+
+    for ( uint16_t i = from; i <= to; i++ )
+        if ( bitmap_get(pending, i) )
+            n++, last = i;
+    if ( !n )
+        return 0;
+    SPI.beginTransaction(eeprom_address_spi);
+    set(OE_pin | CE_pin);
+    eeprom_set_data_out();
+    write(CE_pin, 0);
+    // the sequence turns the protection on and lets the page through either way
+    eeprom_load_byte(0x5555, 0xAA);
+    eeprom_load_byte(0x2AAA, 0x55);
+    eeprom_load_byte(0x5555, 0xA0);
+    for ( uint16_t i = from; i <= last; i++ )
+        if ( bitmap_get(pending, i) )
+            eeprom_load_byte(address + i, buf[i]);
+    eeprom_set_data_in();
+    unsigned long start = micros();
+    while ( micros() - start <= page_load_window_us )
+        if ( eeprom_background )
+            eeprom_background();
+    for ( ;; ) {
+        write(OE_pin, 0);
+        delayMicroseconds(profile.toe_us);
+        uint8_t b = eeprom_data_in();
+        write(OE_pin, 1);
+        if ( !((b ^ buf[last]) & 0x80) || micros() - start > 2000UL * profile.erase_ms )
+            break;
+        if ( eeprom_background )
+            eeprom_background();
+    }
+    set(OE_pin | CE_pin);
+    SPI.endTransaction();
+    return n;
+}
+
+/// Page write block programming of up to 256 bytes into an EEPROM. Only the bytes that differ
+/// from the chip are loaded, each page with such bytes gets one write cycle. The written range
+/// is read back once per round; pages that did not verify are written again, up to
+/// profile.max_pulses rounds. Returns the number of bytes that did not verify.
+int page_write_block(uint32_t address, const uint8_t *buf, uint16_t len, program_result &r)
+{
+    uint8_t pending[32], written[32];
+    verify_block v = { address, buf, pending, 0 };
+    uint16_t page_mask = profile.page_size - 1;
+    unsigned long t = micros();
+
+    memset(&r, 0, sizeof(r));
+    memset(pending, 0xFF, sizeof(pending));
+    if ( len == 0 || len > 256 )
+        return len;
+    eeprom_read_range(address, address + len - 1, v);
+    stats_lap(prog_stats.verify_us, t);
+
+    while ( r.rounds < profile.max_pulses ) {
+        uint16_t n = 0, lo = len, hi = 0;
+        for ( uint16_t i = 0; i < len; ) {
+            uint16_t end = ((address + i) | page_mask) - address;
+            if ( end >= len )
+                end = len - 1;
+            uint16_t loaded = eeprom_write_page(address, buf, pending, i, end);
+            if ( loaded ) {
+                if ( lo == len )
+                    lo = i;
+                hi = end;
+                n += loaded;
+            }
+            i = end + 1;
+        }
+        stats_lap(prog_stats.pulse_us, t);
+        if ( !n )
+            break;
+        r.pulses += n;
+        r.rounds++;
+        memcpy(written, pending, sizeof(written));
+        eeprom_read_range(address + lo, address + hi, v);
+        stats_verified(address, written, pending, lo, hi, r.rounds);
+        stats_lap(prog_stats.verify_us, t);
+    }
+    for ( uint16_t i = 0; i < len; i++ ) {
+        if ( bitmap_get(pending, i) ) {
+            bitmap_set(r.fail_map, i);
+            r.failed++;
+            stats_record(address + i, stats_failed);
+        }
+    }
+    return r.failed;
+}
+
+/// Program up to 256 bytes with the write method of the active device. Returns the number
+/// of bytes that did not verify; r.fail_map tells which.
+int program_block(uint32_t address, const uint8_t *buf, uint16_t len, program_result &r)
+{
+    switch ( profile.write ) {
+        case WRITE_PULSE:
+            return pulse_program_block(address, buf, len, r);
+        case WRITE_PAGE:
+            return page_write_block(address, buf, len, r);
+    }
+    memset(&r, 0, sizeof(r));
+    memset(r.fail_map, 0xFF, sizeof(r.fail_map));
+    r.failed = len;
+    return len;
+}
+
+// false, with a message, if the active device cannot be programmed in this socket
+bool check_writable()
+{
+    if ( profile.write != WRITE_NONE )
+        return true;
+    Serial.print(profile.name);
+    Serial.println(F(" can't be programmed in this socket"));
+    return false;
+}
+
+// list the bytes of a block that did not verify, fail_map has a bit for each
+void print_program_failures(uint32_t address, uint16_t len, uint16_t failed, uint8_t rounds,
+                            const uint8_t *fail_map)
+{
+    Serial.print(failed);
+    Serial.print(F(" bytes failed after "));
+    Serial.print(rounds);
+    Serial.println(F(" rounds:"));
+    for ( uint16_t i = 0; i < len; i++ ) {
+        if ( bitmap_get(fail_map, i) ) {
+            Serial.print(' ');
+            Serial.print(address + i, HEX);
+        }
+    }
+    Serial.println();
+}
+
+void print_program_failures(uint32_t address, uint16_t len, const program_result &r)
+{
+    print_program_failures(address, len, r.failed, r.rounds, r.fail_map);
+}
+
+bool program( uint32_t address, uint8_t *buf, int len)
+{
+    program_result r;
+
+    while ( len > 0 ) {
+        uint16_t n = len > 256 ? 256 : len;
+        if ( program_block(address, buf, n, r) )
+            return false;
+        address += n;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+const uint8_t tune_sample_bytes = 4;        // bytes programmed per autotune trial
+
+// program fresh sample bytes to 0x00 with a single pulse of us each, true if all of them verify
+bool tune_trial(uint32_t address, uint16_t us)
+{
+    uint8_t check[tune_sample_bytes];
+
+    eeprom_program_mode();
+    for ( uint8_t i = 0; i < tune_sample_bytes; i++ )
+        eeprom_program_byte(address + i, 0x00, us);
+    eeprom_verify_mode();
+    eeprom_read_bytes_at(address, check, sizeof(check));
+    for ( uint8_t i = 0; i < tune_sample_bytes; i++ )
+        if ( check[i] != 0x00 )
+            return false;
+    return true;
+}
+
+/// Binary search for the shortest program pulse that programs a blank byte in one go.
+/// Every trial uses fresh bytes of the 256 byte sample area at address, which has to be blank.
+/// The result gets a 50% margin, becomes the active Tpwp and is saved on the SD card for
+/// the chip type. Returns the new pulse width or
+///     -1  sample area not blank
+///     -2  the pulse width of the profile does not program the chip
+///     -3  result could not be saved
+int32_t autotune(uint32_t address)
+{
+    const uint16_t area = 256;
+    check_blank sink = { 0 };
+    uint16_t lo = 0, hi = profile.tpwp_us, used = 0;
+
+    if ( address > device_size() - area || !eeprom_read_range(address, address + area - 1, sink) )
+        return -1;
+    if ( !tune_trial(address, hi) )
+        return -2;
+    used = tune_sample_bytes;
+    // lo never verified, hi did
+    while ( hi - lo > 1 && used + tune_sample_bytes <= area ) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if ( tune_trial(address + used, mid) )
+            hi = mid;
+        else
+            lo = mid;
+        used += tune_sample_bytes;
+    }
+    hi += hi / 2;
+    if ( hi < profile.tpwp_us )
+        profile.tpwp_us = hi;
+
+    if ( !profile_file_save(PSTR("TUN"), profile.tpwp_us) )
+        return -3;
+    return profile.tpwp_us;
+}
+
+/// Read len bytes at address one at a time, with loops counts of _delay_loop_1() (0: none)
+/// between the latch edge and the sample. CE and OE stay low, so a sample taken too early
+/// still shows the byte of the previous address. With compare the bytes are not stored but
+/// checked against buf; returns the number of bytes that differ.
+uint16_t eeprom_read_timed(uint32_t address, uint8_t *buf, uint16_t len, uint8_t loops, bool compare)
+{
+    uint16_t differ = 0;
+
+    eeprom_set_data_in();
+    SPI.beginTransaction(eeprom_address_spi);
+    set(OE_pin | CE_pin);
+    write(CE_pin, 0);
+    write(OE_pin, 0);
+    for ( uint16_t i = 0; i < len; i++ ) {
+        eeprom_shift_address(address + i);
+        eeprom_latch_address();
+        if ( loops )
+            _delay_loop_1(loops);
+        uint8_t b = eeprom_data_in();
+        if ( !compare )
+            buf[i] = b;
+        else if ( b != buf[i] )
+            differ++;
+    }
+    set(OE_pin | CE_pin);
+    SPI.endTransaction();
+    return differ;
+}
+
+const uint8_t calibrate_passes = 4;         // reads of the reference area per delay
+
+// true if every pass over the reference area in buffer reads the same at loops
+bool calibrate_trial(uint32_t address, uint8_t loops)
+{
+    for ( uint8_t pass = 0; pass < calibrate_passes; pass++ )
+        if ( eeprom_read_timed(address, buffer, sizeof(buffer), loops, true) )
+            return false;
+    return true;
+}
+
+/// Search the shortest delay between address latch and sample that still reads the 256 byte
+/// reference area at address correctly. The area is read at the longest delay first; then
+/// the delay is halved until a pass differs and walked down one count (3 cycles) at a time
+/// from the last good one, down to no delay at all. The shortest good delay plus a 50% margin
+/// becomes profile.read_loops and is saved on the SD card for the chip type.
+/// Returns the new delay in ns or
+///     -1  the area does not read the same twice at the longest delay
+///     -2  the area has too few bytes that differ from the one before them to see a late sample
+///     -3  result could not be saved
+int32_t calibrate_read(uint32_t address)
+{
+    const uint8_t slowest = 0xFF;
+    uint16_t changes = 0;
+    uint8_t good = slowest;     // always read correctly
+
+    eeprom_read_timed(address, buffer, sizeof(buffer), slowest, false);
+    if ( !calibrate_trial(address, slowest) )
+        return -1;
+    for ( uint16_t i = 1; i < sizeof(buffer); i++ )
+        if ( buffer[i] != buffer[i - 1] )
+            changes++;
+    if ( changes < 16 )
+        return -2;
+    while ( good && calibrate_trial(address, good / 2) )
+        good /= 2;
+    while ( good && calibrate_trial(address, good - 1) )
+        good--;
+    uint16_t loops = good + good / 2 + 1;
+    profile.read_loops = loops > slowest ? slowest : loops;
+    if ( !profile_file_save(PSTR("CAL"), profile.read_loops) )
+        return -3;
+    return read_loops_ns(profile.read_loops);
+}
+
+/// Next block of an image file. File::read() copies straight out of the block cache of the SD
+/// library; Stream::readBytes() would go through read() and the timeout logic for every
+/// single byte. The file position stays a multiple of the buffer size, so each 512 byte sector
+/// is loaded into the cache once and the second half of it costs only the copy.
+int image_read_block(File &f, uint8_t *buf)
+{
+    int len = f.read(buf, sizeof(buffer));
+    return len > 0 ? len : 0;
+}
+
+// eeprom_read_range() sink that compares the chip with an image block
+struct diff_block
+{
+    uint32_t base;
+    const uint8_t *want;
+    uint32_t differ;        // bytes that have to be programmed
+    uint32_t need_erase;    // bytes with a bit that has to go from 0 to 1
+    uint32_t first_erase;
+
+    bool operator()(uint32_t address, uint8_t b)
+    {
+        uint8_t w = want[(uint16_t)(address - base)];
+        if ( b != w ) {
+            if ( needs_erase(b, w) && !need_erase++ )
+                first_erase = address;
+            differ++;
+        }
+        return true;
+    }
+};
+
+bool is_hex_file(const char *path)
+{
+    static const char extensions[][5] PROGMEM = { "HEX", "IHX", "S19", "S28", "S37", "SRE", "MOT" };
+    const char *dot = strrchr(path, '.');
+
+    if ( !dot )
+        return false;
+    for ( uint8_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++ )
+        if ( strcasecmp_P(dot + 1, extensions[i]) == 0 )
+            return true;
+    return false;
+}
+
+// collects mismatching addresses into ranges, each range is printed when it is closed
+struct mismatch_ranges
+{
+    uint32_t count;
+    uint32_t first, last;
+
+    void add(uint32_t address)
+    {
+        if ( count++ && address == last + 1 ) {
+            last = address;
+            return;
+        }
+        if ( count > 1 )
+            print();
+        first = last = address;
+    }
+    void print()
+    {
+        char line[48];
+        sprintf_P(line, PSTR("  %04lX-%04lX (%lu)"), (unsigned long)first, (unsigned long)last,
+                (unsigned long)(last - first + 1));
+        Serial.println(line);
+    }
+    void finish()
+    {
+        if ( count )
+            print();
+    }
+};
+
+struct hex_burn
+{
+    uint32_t block;         // address of the chip block in buffer
+    bool     loaded;
+    uint32_t bytes;         // data bytes in the file
+    uint32_t differ;
+    uint32_t need_erase;
+    uint32_t first_erase;
+    uint16_t line;          // line of a bad record
+    mismatch_ranges *ranges;    // if set, the validating pass reports the bytes that differ
+};
+
+// burn the block in buffer; bytes the file does not cover hold the chip contents and get no pulse
+bool hex_flush(hex_burn &h)
+{
+    program_result r;
+
+    if ( program_block(h.block, buffer, sizeof(buffer), r) ) {
+        Serial.println();
+        print_program_failures(h.block, sizeof(buffer), r);
+        return false;
+    }
+    Serial.print(r.pulses ? F("#") : F("."));
+    return true;
+}
+
+/// One block of a pass over a HEX or S-record file. The data is merged into buffer, which
+/// holds the chip contents of the 256 byte block the data is in. Without program the pass
+/// only validates the records and counts the bytes that differ from the chip; with program
+/// every block is burned as soon as the data moves on to another block.
+/// Returns 1 while the file goes on, 0 at its end or a negative error code.
+int32_t hex_pass_step(File &f, hex_parser &p, hex_burn &h, bool program)
+{
+    int len = image_read_block(f, stream_buffer);
+    bool end = len <= 0;
+
+    for ( int i = 0; i < len && !end; i++ ) {
+        int8_t rc = hex_feed(p, stream_buffer[i]);
+        if ( rc == HEX_END )
+            end = true;
+        if ( rc < 0 ) {
+            h.line = p.line;
+            return -6;
+        }
+        if ( rc != HEX_DATA )
+            continue;
+        if ( p.address >= device_size() )
+            return -3;
+        uint32_t block = p.address & ~0xFFUL;
+        if ( !h.loaded || block != h.block ) {
+            if ( program && h.loaded && !hex_flush(h) )
+                return -4;
+            eeprom_read_bytes_at(block, buffer, sizeof(buffer));
+            h.block = block;
+            h.loaded = true;
+        }
+        uint8_t &b = buffer[p.address & 0xFF];
+        if ( !program ) {
+            if ( b != p.data ) {
+                if ( needs_erase(b, p.data) && !h.need_erase++ )
+                    h.first_erase = p.address;
+                h.differ++;
+                if ( h.ranges )
+                    h.ranges->add(p.address);
+            }
+            h.bytes++;
+        }
+        b = p.data;
+    }
+    if ( !end )
+        return 1;
+    if ( program && h.loaded && !hex_flush(h) )
+        return -4;
+    return 0;
+}
+
+// a whole pass of hex_pass_step()
+int32_t hex_pass(File &f, hex_burn &h, bool program)
+{
+    hex_parser p;
+    int32_t rc;
+
+    hex_begin(p);
+    h.loaded = false;
+    while ( (rc = hex_pass_step(f, p, h, program)) > 0 )
+        ;
+    return rc;
+}
+
+/// Long operations run as jobs: the command only starts them, loop() then calls job_step()
+/// for one bounded slice of work per pass (one 256 byte block, or job_read_slice bytes of a
+/// blank check) and services the console in between. So status and abort are answered while
+/// a job runs, and the serial receiver is emptied every few milliseconds instead of
+/// overrunning during a whole burn.
+enum job_phase {
+    JOB_IDLE,
+    JOB_ERASE_PULSE,        // waiting for the end of the erase pulse
+    JOB_ERASE_WRITE,        // EEPROM: writing 0xFF block by block
+    JOB_BLANK,              // blank check, also after an erase
+    JOB_DIFF,               // binary image: compare with the chip
+    JOB_BURN,               // binary image: program the blocks that differ
+    JOB_HEX_CHECK,          // HEX/S-record file: check the records, compare with the chip
+    JOB_HEX_BURN            // HEX/S-record file: program
+};
+
+const char job_phase_names[][12] PROGMEM = {
+    "idle", "erase", "erase", "blank check", "compare", "burn", "check", "burn"
+};
+
+const uint16_t job_read_slice = 1024;   // bytes a blank check step reads
+
+const char journal_path[] = "BURN.JNL";
+const uint8_t journal_blocks = 16;      // burned blocks between two journal updates
+
+struct job_state
+{
+    uint8_t  phase;
+    char     command;           // e, b or f: how the result is reported
+    bool     abort;
+    int32_t  rc;                // result of the last job
+    uint32_t address;           // next chip address
+    uint32_t done, total;       // progress of the current phase in bytes
+    unsigned long started;      // millis() at the start of the phase
+    char     name[13];          // file of f
+    File     file;
+    uint32_t start;             // chip address of the image
+    uint32_t skip;              // image bytes verified before the job (resume)
+    uint32_t crc;               // CRC-32 of the image, see journal_write()
+    uint8_t  sockets;           // sockets still in the job, bit n: socket n
+    int8_t   socket_rc[gang_max_sockets];   // why a socket left the job
+    diff_block diff[gang_max_sockets];      // per socket, [0] without the gang board
+    hex_burn hex;
+    hex_parser parser;
+};
+
+job_state job;
+
+inline bool job_running() { return job.phase != JOB_IDLE; }
+
+// "socket n: " in front of a message about one socket of the gang board
+void print_socket(uint8_t n)
+{
+    if ( !gang_sockets )
+        return;
+    Serial.print(F("socket "));
+    Serial.print(n);
+    Serial.print(F(": "));
+}
+
+// socket n leaves the running job with the error rc, the others go on
+void job_drop_socket(uint8_t n, int8_t rc)
+{
+    job.sockets &= ~(1 << n);
+    job.socket_rc[n] = rc;
+}
+
+void job_phase_begin(uint8_t phase, uint32_t total)
+{
+    job.phase = phase;
+    job.done = 0;
+    job.total = total;
+    job.started = millis();
+}
+
+void job_begin(char command)
+{
+    job.command = command;
+    job.abort = false;
+    job.sockets = (1 << socket_count()) - 1;
+    memset(job.socket_rc, 0, sizeof(job.socket_rc));
+}
+
+// End of the job with its result, rc < 0 is an error. On the gang board every socket gets
+// its pass/fail line and the job fails if one socket did.
+void job_end(int32_t rc)
+{
+    if ( job.phase >= JOB_DIFF )
+        job.file.close();
+    job.phase = JOB_IDLE;
+    gang_select = 1 << gang_socket;
+    if ( gang_sockets && rc != -9 ) {
+        for ( uint8_t n = 0; n < gang_sockets; n++ ) {
+            print_socket(n);
+            if ( check_rc(job.socket_rc[n]) )
+                Serial.println(F("ok"));
+            else if ( rc >= 0 )
+                rc = job.socket_rc[n];
+        }
+    }
+    job.rc = rc;
+    if ( job.command == 'f' ) {
+        if ( rc >= 0 )
+            SD.remove(journal_path);
+        check_rc(rc);
+        if ( stats_csv[0] && !stats_append_csv(job.name, rc) ) {
+            Serial.print(F("can't write "));
+            Serial.println(stats_csv);
+        }
+    }
+}
+
+// b, and the check after an erase
+void job_blank_start()
+{
+    job.address = 0;
+    job_phase_begin(JOB_BLANK, device_size());
+}
+
+/// e: erase the chip with the method of the active device, an EEPROM is written with 0xFF.
+/// A blank check follows. Returns false if the chip can only be erased with UV light.
+bool job_erase_start()
+{
+    job_begin('e');
+    Serial.print(F("Erasing..."));
+    if ( gang_sockets )
+        Serial.println();
+    switch ( profile.erase ) {
+        case ERASE_A9_VPE:
+            gang_select = job.sockets;  // all sockets of the gang board at once
+            erase_begin();
+            job_phase_begin(JOB_ERASE_PULSE, 0);
+            return true;
+        case ERASE_NOT_NEEDED:
+            memset(stream_buffer, 0xFF, sizeof(stream_buffer));
+            job.address = 0;
+            job_phase_begin(JOB_ERASE_WRITE, device_size());
+            return true;
+    }
+    Serial.println(F(" needs UV light"));
+    return false;
+}
+
+/// f: burn a file from the SD card. A binary image at adr is compared with the chip first
+/// and only the bytes that differ are programmed; HEX and S-record files are burned at the
+/// addresses of their records, only the ranges they cover get pulses. Nothing is programmed
+/// if a record is bad or a bit has to go from 0 to 1, the chip has to be erased then.
+/// On the gang board the image goes into all sockets, a socket that needs an erase or fails
+/// to verify drops out and the others go on.
+/// The first skip bytes of a binary image are taken as burned already (resume).
+/// Returns 0 if the job runs or -1 file not found, -2 open failed, -3 image does not fit,
+/// -7 HEX/S-record file on the gang board (binary images only).
+/// The job ends with the number of bytes burned or -2 SD read error, -4 verify failed, -5 erase
+/// needed, -6 bad record, -9 aborted.
+int32_t job_burn_start(const char *path, uint32_t adr, uint32_t skip)
+{
+    if ( !SD.exists(const_cast<char *>(path)) )
+        return -1;
+    job.file = SD.open(path);
+    if ( !job.file )
+        return -2;
+    job_begin('f');
+    if ( !skip )
+        SD.remove(journal_path);    // a new burn, the journal of the last one is void
+    memset(&prog_stats, 0, sizeof(prog_stats));
+    strncpy(job.name, path, sizeof(job.name) - 1);
+    job.name[sizeof(job.name) - 1] = 0;
+    Serial.print(F("File: "));
+    Serial.print(path);
+    if ( is_hex_file(path) ) {
+        Serial.println();
+        if ( gang_sockets ) {
+            job.file.close();
+            return -7;
+        }
+        memset(&job.hex, 0, sizeof(job.hex));
+        hex_begin(job.parser);
+        job_phase_begin(JOB_HEX_CHECK, job.file.size());
+        return 0;
+    }
+    uint32_t file_size = job.file.size();
+    if ( file_size + adr > device_size() ) {
+        Serial.println();
+        job.file.close();
+        return -3;
+    }
+    Serial.print(F(" / Size: "));
+    Serial.println(file_size);
+    memset(job.diff, 0, sizeof(job.diff));
+    for ( uint8_t n = 0; n < socket_count(); n++ ) {
+        job.diff[n].base = adr + skip;
+        job.diff[n].want = buffer;
+    }
+    job.start = adr;
+    job.skip = skip;
+    job.crc = CRC32_INIT;
+    job.file.seek(skip);
+    job.address = adr + skip;
+    job_phase_begin(JOB_DIFF, file_size - skip);
+    return 0;
+}
+
+/// Checkpoint of a burn on the SD card: image, its CRC-32, chip address and the image bytes
+/// that are burned and verified. It is written when the burn pass starts and every
+/// journal_blocks blocks, and removed when the job succeeds, so after a failed block, an
+/// abort or a power loss resume can go on from the last checkpoint.
+/// The fields have a fixed width and the file is overwritten in place: an update rewrites the
+/// same data block, the file is never removed and created again in the middle of a burn.
+void journal_write(uint32_t verified)
+{
+    char text[48];
+
+    File f = SD.open(journal_path, O_RDWR | O_CREAT);
+    if ( !f ) {
+        Serial.print(F("can't write "));
+        Serial.println(journal_path);
+        return;
+    }
+    sprintf_P(text, PSTR("%-12s\r\n%08lX\r\n%08lX\r\n%08lX\r\n"), job.name,
+              (unsigned long)job.crc, (unsigned long)job.start, (unsigned long)verified);
+    f.seek(0);
+    f.write((const uint8_t *)text, strlen(text));
+    f.close();
+}
+
+// eeprom_read_range() sink computing a CRC-32
+struct crc32_sink
+{
+    uint32_t crc;
+    bool operator()(uint32_t, uint8_t b) { crc = crc32_update(crc, b); return true; }
+};
+
+// next hex field of the journal (strtoul() skips the line break before it), false at the end
+bool journal_field(char *&p, unsigned long &value)
+{
+    char *end;
+
+    value = strtoul(p, &end, 16);
+    if ( end == p )
+        return false;
+    p = end;
+    return true;
+}
+
+/// resume: continue the burn of the journal. The image has to have the CRC-32 of the journal
+/// and the chip has to hold its first verified bytes (compared by CRC-32), then the rest is
+/// burned like f does: compared with the chip, then programmed.
+/// Returns 0 if the job runs or -1 no journal, -2 image missing or changed, -3 chip does not
+/// hold the verified part, -7 gang board, or the errors of job_burn_start().
+int32_t job_resume_start()
+{
+    char text[48], name[13];
+    unsigned long crc, adr, verified;
+    uint32_t image_crc = CRC32_INIT, prefix_crc = CRC32_INIT;
+    crc32_sink chip = { CRC32_INIT };
+    uint32_t pos = 0;
+    int len;
+
+    File f = SD.open(journal_path);
+    if ( !f )
+        return -1;
+    len = f.readBytes(text, sizeof(text) - 1);
+    text[len] = 0;
+    f.close();
+    char *p = text;
+    uint8_t n = 0;
+    while ( *p > ' ' && n < sizeof(name) - 1 )
+        name[n++] = *p++;
+    name[n] = 0;
+    if ( !n || !journal_field(p, crc) || !journal_field(p, adr) || !journal_field(p, verified) )
+        return -1;
+    if ( gang_sockets )
+        return -7;
+    f = SD.open(name);
+    if ( !f )
+        return -2;
+    while ( (len = image_read_block(f, buffer)) > 0 ) {
+        for ( int i = 0; i < len; i++, pos++ ) {
+            if ( pos == verified )
+                prefix_crc = image_crc;
+            image_crc = crc32_update(image_crc, buffer[i]);
+        }
+    }
+    f.close();
+    if ( pos == verified )
+        prefix_crc = image_crc;
+    if ( ~image_crc != crc || verified > pos )
+        return -2;
+    if ( verified && adr + pos <= device_size() )
+        eeprom_read_range(adr, adr + verified - 1, chip);
+    if ( chip.crc != prefix_crc )
+        return -3;
+    Serial.print(F("Resume at "));
+    Serial.println(adr + verified, HEX);
+    int32_t rc = job_burn_start(name, adr, verified);
+    job.crc = crc;
+    return rc;
+}
+
+void job_blank_step()
+{
+    uint32_t n = job.total - job.done;
+
+    if ( n > job_read_slice )
+        n = job_read_slice;
+    for ( uint8_t k = 0; k < socket_count(); k++ ) {
+        check_blank sink = { 0 };
+        if ( !(job.sockets >> k & 1) )
+            continue;
+        gang_select = 1 << k;
+        if ( eeprom_read_range(job.address, job.address + n - 1, sink) )
+            continue;
+        if ( job.command == 'e' && !gang_sockets )
+            Serial.println(F(" failed"));
+        else {
+            print_socket(k);
+            Serial.print(F("failed on address "));
+            Serial.println(sink.fail, HEX);
+        }
+        job_drop_socket(k, -1);
+    }
+    if ( !job.sockets ) {
+        job_end(-1);
+        return;
+    }
+    job.address += n;
+    job.done += n;
+    if ( job.done == job.total ) {
+        if ( !gang_sockets )
+            Serial.println(job.command == 'e' ? F(" ok") : F("ok!"));
+        job_end(0);
+    }
+}
+
+void job_erase_write_step()
+{
+    program_result r;
+
+    if ( program_block(job.address, stream_buffer, sizeof(stream_buffer), r) ) {
+        Serial.println(F(" failed"));
+        job_end(-4);
+        return;
+    }
+    job.address += sizeof(stream_buffer);
+    job.done += sizeof(stream_buffer);
+    if ( job.done >= job.total )
+        job_blank_start();
+}
+
+// binary image, first pass: which bytes differ, does any need an erase
+void job_diff_step()
+{
+    int len = image_read_block(job.file, buffer);
+
+    if ( !len && job.file.available() ) {
+        job_end(-2);            // read error, the file would never come to its end
+        return;
+    }
+    if ( len ) {
+        if ( !job.skip )
+            for ( int i = 0; i < len; i++ )
+                job.crc = crc32_update(job.crc, buffer[i]);
+        for ( uint8_t n = 0; n < socket_count(); n++ ) {
+            diff_block &d = job.diff[n];
+            gang_select = 1 << n;
+            eeprom_read_range(d.base, d.base + len - 1, d);
+            d.base += len;
+        }
+        job.done += len;
+    }
+    if ( job.file.available() )
+        return;
+    for ( uint8_t n = 0; n < socket_count(); n++ ) {
+        const diff_block &d = job.diff[n];
+        print_socket(n);
+        Serial.print(d.differ);
+        Serial.println(F(" bytes differ"));
+        if ( d.need_erase ) {
+            print_socket(n);
+            Serial.print(d.need_erase);
+            Serial.print(F(" bytes need an erase, first at "));
+            Serial.println(d.first_erase, HEX);
+            job_drop_socket(n, -5);
+        }
+    }
+    if ( !job.sockets ) {
+        job_end(-5);
+        return;
+    }
+    job.file.seek(job.skip);
+    if ( !job.skip )
+        job.crc = ~job.crc;
+    if ( !gang_sockets )
+        journal_write(job.skip);
+    Serial.print(F("Programming ... "));
+    job_phase_begin(JOB_BURN, job.total);
+}
+
+// gang board: one block into all sockets still in the job, the ones that fail drop out
+bool job_gang_burn_block(uint16_t len)
+{
+    // 171 bytes, too much for the stack under the job frames. A burn of a binary image does
+    // not use the second block buffer, so the result lives there.
+    static_assert(sizeof(gang_result) <= sizeof(stream_buffer), "gang_result outgrew stream_buffer");
+    gang_result &r = *(gang_result *)stream_buffer;
+    uint8_t failed = gang_program_block(job.address, buffer, len, job.sockets, r);
+
+    for ( uint8_t n = 0; n < gang_sockets; n++ ) {
+        if ( !(failed >> n & 1) )
+            continue;
+        Serial.println();
+        print_socket(n);
+        print_program_failures(job.address, len, r.failed[n], r.rounds, r.pending[n]);
+        job_drop_socket(n, -4);
+    }
+    if ( !job.sockets ) {
+        job_end(-4);
+        return false;
+    }
+    Serial.print(r.pulses ? F("#") : F("."));
+    return true;
+}
+
+// binary image, second pass: one block; blocks that match get no pulses
+void job_burn_step()
+{
+    int len = image_read_block(job.file, buffer);
+
+    if ( !len && job.file.available() ) {
+        Serial.println();
+        job_end(-2);            // read error, the file would never come to its end
+        return;
+    }
+    if ( len ) {
+        if ( gang_sockets ) {
+            if ( !job_gang_burn_block(len) )
+                return;
+        }
+        else {
+            program_result r;
+            if ( program_block(job.address, buffer, len, r) ) {
+                Serial.println();
+                print_program_failures(job.address, len, r);
+                job_end(-4);
+                return;
+            }
+            Serial.print(r.pulses ? F("#") : F("."));
+        }
+        job.address += len;
+        job.done += len;
+        if ( !gang_sockets && (job.done / sizeof(buffer)) % journal_blocks == 0 )
+            journal_write(job.skip + job.done);
+    }
+    if ( job.file.available() )
+        return;
+    Serial.println();
+    Serial.print(job.done);
+    Serial.print(F(" bytes written"));
+    if ( !gang_sockets ) {
+        Serial.print(F(", "));
+        Serial.print(job.diff[0].differ);
+        Serial.print(F(" programmed"));
+    }
+    Serial.println();
+    job_end(job.done);
+}
+
+// HEX and S-record files: one block of the checking or the burning pass
+void job_hex_step()
+{
+    bool program = job.phase == JOB_HEX_BURN;
+    int32_t rc = hex_pass_step(job.file, job.parser, job.hex, program);
+
+    job.done = job.file.position();
+    if ( rc > 0 )
+        return;
+    if ( rc < 0 ) {
+        if ( program )
+            Serial.println();
+        if ( rc == -6 ) {
+            Serial.print(F("bad record in line "));
+            Serial.println(job.hex.line);
+        }
+        job_end(rc);
+        return;
+    }
+    if ( program ) {
+        Serial.println();
+        Serial.print(job.hex.differ);
+        Serial.println(F(" bytes programmed"));
+        job_end(job.hex.bytes);
+        return;
+    }
+    Serial.print(job.hex.bytes);
+    Serial.print(F(" data bytes, "));
+    Serial.print(job.hex.differ);
+    Serial.println(F(" differ"));
+    if ( job.hex.need_erase ) {
+        Serial.print(job.hex.need_erase);
+        Serial.print(F(" bytes need an erase, first at "));
+        Serial.println(job.hex.first_erase, HEX);
+        job_end(-5);
+        return;
+    }
+    job.file.seek(0);
+    hex_begin(job.parser);
+    job.hex.loaded = false;
+    Serial.print(F("Programming ... "));
+    job_phase_begin(JOB_HEX_BURN, job.total);
+}
+
+// one slice of the running job
+void job_step()
+{
+    if ( job.abort ) {
+        if ( job.phase == JOB_ERASE_PULSE )
+            erase_end();
+        Serial.println();
+        Serial.println(F("aborted"));
+        job_end(-9);
+        return;
+    }
+    switch ( job.phase ) {
+        case JOB_ERASE_PULSE:
+            if ( millis() - job.started < profile.erase_ms )
+                return;
+            erase_end();
+            job_blank_start();
+            return;
+        case JOB_ERASE_WRITE:
+            job_erase_write_step();
+            return;
+        case JOB_BLANK:
+            job_blank_step();
+            return;
+        case JOB_DIFF:
+            job_diff_step();
+            return;
+        case JOB_BURN:
+            job_burn_step();
+            return;
+        case JOB_HEX_CHECK:
+        case JOB_HEX_BURN:
+            job_hex_step();
+            return;
+    }
+}
+
+/// status: phase of the running job, its progress, throughput and the time left for the
+/// phase; the result of the last job when none runs
+bool job_status()
+{
+    unsigned long ms = millis() - job.started;
+
+    Serial.print((const __FlashStringHelper *)job_phase_names[job.phase]);
+    if ( !job_running() ) {
+        Serial.print(F(", last result "));
+        Serial.println(job.rc);
+        return true;
+    }
+    if ( job.command == 'f' ) {
+        Serial.print(' ');
+        Serial.print(job.name);
+    }
+    Serial.print(F(": "));
+    if ( job.phase == JOB_ERASE_PULSE ) {
+        Serial.print(ms);
+        Serial.print(F(" of "));
+        Serial.print(profile.erase_ms);
+        Serial.println(F(" ms"));
+        return true;
+    }
+    Serial.print(job.done);
+    Serial.print(F(" / "));
+    Serial.print(job.total);
+    Serial.print(F(" bytes"));
+    uint32_t rate = ms ? job.done * 1000UL / ms : 0;     // done is at most 512 KB
+    if ( rate ) {
+        Serial.print(F(", "));
+        Serial.print(rate);
+        Serial.print(F(" B/s, ETA "));
+        Serial.print((job.total - job.done + rate - 1) / rate);
+        Serial.print(F(" s"));
+    }
+    Serial.println();
+    return true;
+}
+
+// abort: the running job stops before its next slice
+bool job_abort()
+{
+    if ( !job_running() ) {
+        Serial.println(F("?"));
+        return false;
+    }
+    job.abort = true;
+    return true;
+}
+
+const uint8_t read_slice = 32;  // bytes read between two top-ups of the TX ring
+
+// Stream a chip range to the host as DATA frames of up to sizeof(buffer) bytes. While block
+// N goes out of the TX ring, block N + 1 is read into the other buffer in slices, topping up
+// the ring in between, so the chip reads hide behind the transmission. A block that is not
+// acknowledged is sent again the plain way.
+int8_t binary_read(uint32_t address, uint32_t len)
+{
+    uint8_t *blocks[2] = { buffer, stream_buffer };
+    uint8_t cur = 0;
+    uint8_t seq = 0;
+    uint16_t chunk = len > sizeof(buffer) ? sizeof(buffer) : len;
+    frame_tx tx;
+    int8_t rc;
+
+    eeprom_read_bytes_at(address, blocks[cur], chunk);
+    while ( len ) {
+        frame_tx_begin(tx, FRAME_DATA, seq, blocks[cur], chunk);
+        address += chunk;
+        len -= chunk;
+        uint16_t next = len > sizeof(buffer) ? sizeof(buffer) : len;
+        for ( uint16_t off = 0; off < next; off += read_slice ) {
+            frame_tx_pump(tx);
+            eeprom_read_bytes_at(address + off, blocks[cur ^ 1] + off,
+                                 next - off < read_slice ? next - off : read_slice);
+        }
+        frame_tx_finish(tx);
+        if ( frame_wait_ack(seq) != FRAME_OK
+             && (rc = frame_send_reliable(FRAME_DATA, seq, blocks[cur], chunk)) != FRAME_OK )
+            return rc;
+        seq++;
+        cur ^= 1;
+        chunk = next;
+    }
+    return FRAME_OK;
+}
+
+frame_rx stream_rx;
+int8_t stream_rc;      // state of the block received in the background
+
+// background work during program pulses: receive the next block
+void stream_receive_step()
+{
+    if ( stream_rc == FRAME_PENDING && Serial.available() )
+        stream_rc = frame_rx_feed(stream_rx, Serial.read());
+}
+
+// eeprom_read_range() sink: false at the first byte that is not 0xFF. Keeps the background
+// work going, the read of a block takes longer than the USART needs to fill its RX ring.
+struct check_erased
+{
+    bool operator()(uint32_t, uint8_t b)
+    {
+        if ( eeprom_background )
+            eeprom_background();
+        return b == 0xFF;
+    }
+};
+
+// true if a block of an erasable chip is all 0xFF and the chip holds 0xFF there already, so
+// it needs no programming
+bool blank_block(uint32_t address, const uint8_t *buf, uint16_t len)
+{
+    if ( profile.erase == ERASE_NOT_NEEDED )
+        return false;
+    for ( uint16_t i = 0; i < len; i++ )
+        if ( buf[i] != 0xFF )
+            return false;
+    check_erased sink;
+    return eeprom_read_range(address, address + len - 1, sink);
+}
+
+// FRAME_START: program len bytes at address with the data of the following WRITE or PACKED
+// frames. Block N is programmed while block N+1 is received into the other buffer; a PACKED
+// block is decoded into the other buffer and the next frame is received into its own. The
+// ACK for a block is sent as soon as a buffer is free for the next one; it is the host's only
+// credit to send, so it is never more than one block ahead and the 64 byte RX ring of the
+// core driver cannot overrun. Blocks that are all 0xFF are skipped where the chip reads back 0xFF already.
+int8_t binary_stream_program(uint32_t address, uint32_t len, uint32_t *written)
+{
+    uint8_t *blocks[2] = { buffer, stream_buffer };
+    uint8_t cur = 0;
+    uint8_t seq = 0;
+    uint8_t tries = 0;
+    int8_t rc;
+
+    *written = 0;
+    frame_rx_begin(stream_rx, blocks[cur], sizeof(buffer));
+    rc = frame_rx_poll(stream_rx, 1000);
+    for ( ;; ) {
+        bool data = stream_rx.h.type == FRAME_WRITE || stream_rx.h.type == FRAME_PACKED;
+        if ( rc != FRAME_OK || !data || stream_rx.h.seq != seq ) {
+            bool repeated = rc == FRAME_OK && data && stream_rx.h.seq == (uint8_t)(seq - 1);
+            if ( rc == FRAME_OK )
+                rc = FRAME_BAD_ARGS;
+            if ( rc == FRAME_TIMEOUT || ++tries > 5 )
+                return rc;
+            if ( repeated )
+                frame_send(FRAME_ACK, stream_rx.h.seq, 0, 0);  // our ACK got lost, the host repeated
+            else
+                frame_nak(seq, rc);
+            frame_rx_begin(stream_rx, blocks[cur], sizeof(buffer));
+            rc = frame_rx_poll(stream_rx, 1000);
+            continue;
+        }
+        tries = 0;
+        int16_t n = stream_rx.h.len;
+        uint8_t *block = blocks[cur];
+        uint8_t next = cur ^ 1;     // buffer for the next frame
+        if ( stream_rx.h.type == FRAME_PACKED ) {
+            block = blocks[next];
+            next = cur;
+            n = unpack_block(blocks[cur], n, block, len < sizeof(buffer) ? len : sizeof(buffer));
+            if ( n < 0 )
+                return FRAME_BAD_PACKING;
+        }
+        if ( n == 0 || (uint32_t)n > len )
+            return FRAME_BAD_ARGS;
+        len -= n;
+        frame_send(FRAME_ACK, seq++, 0, 0);
+        if ( len ) {
+            frame_rx_begin(stream_rx, blocks[next], sizeof(buffer));
+            stream_rc = FRAME_PENDING;
+            eeprom_background = stream_receive_step;
+        }
+        bool ok = blank_block(address, block, n) || program(address, block, n);
+        eeprom_background = 0;
+        if ( !ok ) {
+            // the host has the credit for the next block and sends it: take it off the line,
+            // otherwise its rest would be read as the next command
+            if ( len && stream_rc == FRAME_PENDING )
+                frame_rx_poll(stream_rx, 1000);
+            return FRAME_PROGRAM_FAILED;
+        }
+        address += n;
+        *written += n;
+        if ( !len )
+            return FRAME_OK;
+        cur = next;
+        rc = stream_rc == FRAME_PENDING ? frame_rx_poll(stream_rx, 1000) : stream_rc;
+    }
+}
+
+// address (2 or 3 bytes) and length (3 bytes) of FRAME_READ and FRAME_START
+bool frame_range_args(const frame_header &h, const uint8_t *args, uint32_t &address, uint32_t &len)
+{
+    uint8_t n = h.len - 3;
+
+    if ( h.len != 5 && h.len != 6 )
+        return false;
+    address = args[0] | ((uint16_t)args[1] << 8);
+    if ( n == 3 )
+        address |= (uint32_t)args[2] << 16;
+    len = args[n] | ((uint16_t)args[n + 1] << 8) | ((uint32_t)args[n + 2] << 16);
+    return true;
+}
+
+// one command in binary mode, see frame.h
+void binary_command()
+{
+    frame_header h;
+    uint8_t args[6];
+    int8_t rc;
+
+    rc = frame_receive(h, args, sizeof(args), 100);
+    if ( rc == FRAME_TIMEOUT )
+        return;
+    if ( rc != FRAME_OK ) {
+        frame_nak(h.seq, rc);
+        return;
+    }
+    switch ( h.type ) {
+        case FRAME_PING:
+            frame_send(FRAME_ACK, h.seq, 0, 0);
+            break;
+        case FRAME_READ: {
+            uint32_t address, len;
+            if ( !frame_range_args(h, args, address, len) ) {
+                frame_nak(h.seq, FRAME_BAD_ARGS);
+                break;
+            }
+            if ( len == 0 || address >= device_size() || len > device_size() - address ) {
+                frame_nak(h.seq, FRAME_BAD_ARGS);
+                break;
+            }
+            frame_send(FRAME_ACK, h.seq, 0, 0);
+            binary_read(address, len);
+            break;
+        }
+        case FRAME_START: {
+            uint32_t address, len;
+            if ( !frame_range_args(h, args, address, len) ) {
+                frame_nak(h.seq, FRAME_BAD_ARGS);
+                break;
+            }
+            if ( len == 0 || address >= device_size() || len > device_size() - address || profile.write == WRITE_NONE ) {
+                frame_nak(h.seq, FRAME_BAD_ARGS);
+                break;
+            }
+            frame_send(FRAME_ACK, h.seq, 0, 0);
+            uint32_t written;
+            uint8_t result[4];
+            result[0] = binary_stream_program(address, len, &written);
+            result[1] = written;
+            result[2] = written >> 8;
+            result[3] = written >> 16;
+            frame_send(FRAME_END, h.seq, result, sizeof(result));
+            break;
+        }
+        case FRAME_BAUD: {
+            if ( h.len != 4 ) {
+                frame_nak(h.seq, FRAME_BAD_ARGS);
+                break;
+            }
+            unsigned long old_baud = serial_baud;
+            serial_baud = args[0] | ((uint16_t)args[1] << 8) | ((uint32_t)args[2] << 16) | ((uint32_t)args[3] << 24);
+            frame_send(FRAME_ACK, h.seq, 0, 0);
+            Serial.flush();
+            Serial.begin(serial_baud);
+            // the host confirms the new rate with a PING, otherwise fall back
+            if ( frame_receive(h, args, sizeof(args), 1000) == FRAME_OK && h.type == FRAME_PING )
+                frame_send(FRAME_ACK, h.seq, 0, 0);
+            else {
+                serial_baud = old_baud;
+                Serial.begin(serial_baud);
+            }
+            break;
+        }
+        case FRAME_QUIT:
+            frame_send(FRAME_ACK, h.seq, 0, 0);
+            Serial.flush();
+            if ( serial_baud != console_baud )
+                Serial.begin(serial_baud = console_baud);
+            binary_mode = false;
+            break;
+        default:
+            frame_nak(h.seq, FRAME_UNKNOWN);
+    }
+}
+
+// eeprom_read_range() sink feeding a digest
+struct checksum_sink
+{
+    checksum *c;
+    bool operator()(uint32_t, uint8_t b) { checksum_update(*c, b); return true; }
+};
+
+// optional digest name after a command, crc32 if there is none
+int8_t checksum_type_arg(tokenizer &t)
+{
+    const char *name = token_next(t);
+    return name ? checksum_type_from_name(name) : (int8_t)CHECKSUM_CRC32;
+}
+
+void print_digest(checksum &c)
+{
+    uint8_t digest[20];
+    uint8_t len = checksum_end(c, digest);
+    char hex[3];
+
+    for ( uint8_t i = 0; i < len; i++ ) {
+        sprintf_P(hex, PSTR("%02x"), digest[i]);
+        Serial.print(hex);
+    }
+    Serial.println();
+}
+
+// the CRC-32 of crc32_update() steps, as print_digest() prints it
+void print_crc32(uint32_t crc)
+{
+    char hex[9];
+
+    sprintf_P(hex, PSTR("%08lx"), (unsigned long)~crc);
+    Serial.println(hex);
+}
+
+/// checksum <start> <len> [crc32|sha1]: digest of a chip range
+bool checksum_command(uint32_t start, uint32_t len, int8_t type)
+{
+    checksum c;
+    checksum_sink sink = { &c };
+
+    if ( len == 0 || start >= device_size() || len > device_size() - start ) {
+        Serial.println(F("?"));
+        return false;
+    }
+    checksum_begin(c, type);
+    eeprom_read_range(start, start + len - 1, sink);
+    print_digest(c);
+    return true;
+}
+
+const uint16_t blank_map_blocks = 256;  // a block is 1/256 of the chip, 256 bytes of a 27C512
+
+// eeprom_read_range() sink counting the bytes of a block that are not 0xFF
+struct count_used
+{
+    uint16_t used;
+    bool operator()(uint32_t, uint8_t b) { used += b != 0xFF; return true; }
+};
+
+// bytes not 0xFF in block i of the last blank_map_scan()
+inline uint16_t blank_map_count(uint16_t i)
+{
+    return buffer[i] | stream_buffer[i] << 8;
+}
+
+/// Read the whole chip with the sequential read path and set bit i of map (32 bytes) for every
+/// block i that is not blank. The counts of bytes that are not 0xFF go to the block buffers,
+/// low bytes to buffer and high bytes to stream_buffer, see blank_map_count().
+/// Returns the number of blocks that are not blank.
+uint16_t blank_map_scan(uint8_t *map)
+{
+    uint32_t size = device_size() / blank_map_blocks;
+    uint16_t used = 0;
+
+    memset(map, 0, blank_map_blocks / 8);
+    for ( uint16_t i = 0; i < blank_map_blocks; i++ ) {
+        count_used sink = { 0 };
+        eeprom_read_range(i * size, (i + 1) * size - 1, sink);
+        buffer[i] = sink.used;
+        stream_buffer[i] = sink.used >> 8;
+        if ( sink.used ) {
+            bitmap_set(map, i);
+            used++;
+        }
+    }
+    return used;
+}
+
+/// blankmap: the chip as runs of blank and used blocks. The line of a used run is followed
+/// by the bytes that are not 0xFF in each of its blocks (hex, 16 blocks a line).
+bool blank_map_command()
+{
+    uint8_t map[blank_map_blocks / 8];
+    uint32_t size = device_size() / blank_map_blocks;
+    uint16_t used = blank_map_scan(map);
+
+    Serial.print(F("blank map, "));
+    Serial.print(size);
+    Serial.println(F(" byte blocks"));
+    for ( uint16_t i = 0, end; i < blank_map_blocks; i = end ) {
+        bool is_used = bitmap_get(map, i);
+        for ( end = i + 1; end < blank_map_blocks && bitmap_get(map, end) == is_used; end++ )
+            ;
+        Serial.print(i * size, HEX);
+        Serial.print('-');
+        Serial.print(end * size - 1, HEX);
+        Serial.println(is_used ? F(" used:") : F(" blank"));
+        for ( uint16_t k = i; is_used && k < end; k++ ) {
+            Serial.print(' ');
+            Serial.print(blank_map_count(k), HEX);
+            if ( (k - i) % 16 == 15 || k == end - 1 )
+                Serial.println();
+        }
+    }
+    Serial.print(used);
+    Serial.print(F(" of "));
+    Serial.print(blank_map_blocks);
+    Serial.println(F(" blocks used"));
+    return true;
+}
+
+/// filesum <file> [crc32|sha1]: the same digest over a file on the SD card
+bool filesum_command(const char *path, int8_t type)
+{
+    File f = SD.open(path);
+    if ( !f ) {
+        Serial.println(F("?"));
+        return false;
+    }
+    checksum c;
+    checksum_begin(c, type);
+    int len;
+    while ( (len = f.read(buffer, sizeof(buffer))) > 0 )
+        for ( int i = 0; i < len; i++ )
+            checksum_update(c, buffer[i]);
+    f.close();
+    print_digest(c);
+    return true;
+}
+
+// eeprom_read_range() sink comparing the chip with a block of an image file
+struct compare_image
+{
+    uint32_t base;
+    const uint8_t *want;
+    uint32_t crc;
+    mismatch_ranges *ranges;
+
+    bool operator()(uint32_t address, uint8_t b)
+    {
+        crc = crc32_update(crc, b);
+        if ( b != want[(uint16_t)(address - base)] )
+            ranges->add(address);
+        return true;
+    }
+};
+
+/// Verify the chip against an image file at adr (HEX and S-record files at their own
+/// addresses). File and chip are read in lockstep in sector aligned blocks; a block of the
+/// file is already in RAM, so the chip bytes are compared with it directly while they are
+/// read, which is cheaper than a CRC on both sides. Differences are printed as address
+/// ranges, for binary images followed by the CRC-32 of the chip range.
+/// Returns the number of bytes that differ or the error codes of job_burn_start().
+int32_t verifyFile(const char *path, uint32_t adr)
+{
+    mismatch_ranges ranges = { 0, 0, 0 };
+    int len;
+
+    File f = SD.open(path);
+    if ( !f )
+        return -2;
+    if ( is_hex_file(path) ) {
+        hex_burn h = { 0, false, 0, 0, 0, 0, 0, &ranges };
+        int32_t rc = hex_pass(f, h, false);
+        f.close();
+        if ( rc < 0 )
+            return rc;
+        ranges.finish();
+        Serial.print(h.bytes);
+        Serial.print(F(" data bytes, "));
+        Serial.print(ranges.count);
+        Serial.println(F(" differ"));
+        return ranges.count;
+    }
+    if ( f.size() + adr > device_size() ) {
+        f.close();
+        return -3;
+    }
+    compare_image sink = { adr, buffer, CRC32_INIT, &ranges };
+    while ( (len = image_read_block(f, buffer)) > 0 ) {
+        eeprom_read_range(sink.base, sink.base + len - 1, sink);
+        sink.base += len;
+    }
+    f.close();
+    ranges.finish();
+    Serial.print(ranges.count);
+    Serial.print(F(" bytes differ, crc32 "));
+    print_crc32(sink.crc);
+    return ranges.count;
+}
+
+// eeprom_read_range() sink copying a block to a buffer and computing a CRC-32
+struct dump_sink
+{
+    uint8_t *p;
+    uint32_t crc;
+    bool operator()(uint32_t, uint8_t b) { *p++ = b; crc = crc32_update(crc, b); return true; }
+};
+
+/// Dump len bytes of the chip from start into a file on the SD card, followed by the CRC-32
+/// of the data written. The file is written from its start in blocks that stay aligned to the
+/// 512 byte sectors: a sector past the end of the file is not read before it is filled, and
+/// the block cache of the SD library writes it only once. The directory entry is updated once
+/// when the file is closed.
+/// Returns the number of bytes written or -2 open failed, -3 bad range, -7 card full.
+int32_t dumpFile(const char *path, uint32_t start, uint32_t len)
+{
+    uint32_t done = 0;
+    uint32_t crc = CRC32_INIT;
+
+    if ( len == 0 || start >= device_size() || len > device_size() - start )
+        return -3;
+    File f = SD.open(path, O_RDWR | O_CREAT | O_TRUNC);
+    if ( !f )
+        return -2;
+    while ( done < len ) {
+        uint16_t n = len - done > sizeof(buffer) ? sizeof(buffer) : len - done;
+        dump_sink sink = { buffer, crc };
+        eeprom_read_range(start + done, start + done + n - 1, sink);
+        crc = sink.crc;
+        if ( f.write(buffer, n) != n ) {
+            f.close();
+            return -7;
+        }
+        done += n;
+    }
+    f.close();
+    Serial.print(done);
+    Serial.print(F(" bytes, crc32 "));
+    print_crc32(crc);
+    return done;
+}
+
+// XON/XOFF flow control of the console: the RX vector stops the sender when the ring is half
+// full (lines queued behind a job), the other half takes what the sender's FIFO still has. It
+// is resumed when the ring has drained to 1/8.
+bool flow_xon = false;
+
+void console_rx_high()
+{
+    if ( !binary_mode )
+        serial_send_now(XOFF);
+}
+
+void console_rx_low()
+{
+    if ( !binary_mode )
+        serial_send_now(XON);
+}
+
+void set_flow(bool xon)
+{
+    flow_xon = xon;
+    if ( xon )
+        serial_set_watermarks(SERIAL_RX_BUFFER_SIZE / 2, SERIAL_RX_BUFFER_SIZE / 8, console_rx_high, console_rx_low);
+    else
+        serial_set_watermarks(0, 0, 0, 0);
+}
+
+// ToDo
+bool confirmation()
+{
+    // confirmation_needed = true;
+    // Serial.print("Confirm [y/N]? ");
+    // while ( confirmation_needed ); 
+    // Serial.println();
+    // return confirmation_given;
+    return false;
+}
+
+void setup()
+{
+    memset(buffer, 0x55, sizeof(buffer));
+
+    // initialize serial
+    Serial.begin(console_baud);
+    while ( !Serial );
+
+    eeprom_init_pins();
+    eeprom_set_data_in();
+    
+    Serial.println(F("EEPrommer V0"));   
+    SPI.begin();
+
+    if ( !SD.begin(SS) )
+        Serial.println(F("SD Init fail"));
+    eeprom_select_profile(read_id(), false);
+    print_profile();
+
+
+}
+
+uint32_t adr = 0;           // current address of a, r, p, f and v
+uint32_t nextAdr = 0;       // address of the next n
+line_ring console;          // command lines received on the serial port
+// the command line being executed: from the console, from a script (run_script() reads its
+// lines into it once the script is open) or status/abort (job_control()); one copy for all,
+// the stack has no room for nested ones
+char command_line[command_line_size];
+bool script_running = false;
+
+bool syntax_error()
+{
+    Serial.println(F("?"));
+    return false;
+}
+
+// prints the return code of a failed command; true if rc is not an error
+bool check_rc(int32_t rc)
+{
+    if ( rc < 0 ) {
+        Serial.print(F("return code = "));
+        Serial.println(rc);
+        return false;
+    }
+    return true;
+}
+
+/// Execute one command line, see README.md. Word commands need a blank before their
+/// arguments; the argument of a single letter command may follow without one (fimage.bin).
+/// Returns false if the command failed or was not understood, which stops a script.
+bool execute_command(char *line)
+{
+    tokenizer t;
+    uint32_t value, len;
+    const char *name;
+    int8_t type;
+
+    // fill Befehl
+    tokenizer_begin(t, line);
+    if ( token_end(t) )
+        return true;
+    if ( token_word(t, PSTR("status")) )
+        return job_status();
+    if ( token_word(t, PSTR("abort")) )
+        return job_abort();
+    if ( token_word(t, PSTR("autotune")) ) {
+        // autotune [address of a blank 256 byte sample area], default: current address
+        value = adr;
+        if ( arg_number(t, value) == ARG_BAD || value >= device_size() )
+            return syntax_error();
+        if ( profile.write != WRITE_PULSE )     // nothing to tune for page writes
+            return syntax_error();
+        Serial.print(F("Autotune at ")); Serial.println(value, HEX);
+        int32_t us = autotune(value);
+        print_profile();
+        return check_rc(us);
+    }
+    if ( token_word(t, PSTR("calibrate")) ) {
+        // calibrate [address of a 256 byte reference area with data], default: current address
+        value = adr;
+        if ( arg_number(t, value) == ARG_BAD || value > device_size() - 256 )
+            return syntax_error();
+        Serial.print(F("Read calibration at ")); Serial.println(value, HEX);
+        int32_t ns = calibrate_read(value);
+        print_profile();
+        return check_rc(ns);
+    }
+    if ( token_word(t, PSTR("blankmap")) )
+        return blank_map_command();
+    if ( token_word(t, PSTR("checksum")) ) {
+        if ( arg_number(t, value) != ARG_OK || arg_length(t, len) != ARG_OK
+             || (type = checksum_type_arg(t)) < 0 )
+            return syntax_error();
+        return checksum_command(value, len, type);
+    }
+    if ( token_word(t, PSTR("filesum")) ) {
+        if ( arg_filename(t, name) != ARG_OK || (type = checksum_type_arg(t)) < 0 )
+            return syntax_error();
+        return filesum_command(name, type);
+    }
+    if ( token_word(t, PSTR("device")) ) {
+        // device [name]: select a chip type, without a name list the known ones
+        if ( arg_filename(t, name) == ARG_OK ) {
+            if ( !eeprom_select_profile_by_name(name) )
+                return syntax_error();
+        }
+        else {
+            for ( uint8_t i = 0; i < device_profile_count; i++ ) {
+                Serial.print(' ');
+                Serial.print((const __FlashStringHelper *)device_profiles[i].name);
+            }
+            Serial.println();
+        }
+        print_profile();
+        return true;
+    }
+    if ( token_word(t, PSTR("flow")) ) {
+        // flow [xon | off]: XON/XOFF flow control of the console
+        if ( token_word(t, PSTR("xon")) )
+            set_flow(true);
+        else if ( token_word(t, PSTR("off")) )
+            set_flow(false);
+        else if ( !token_end(t) )
+            return syntax_error();
+        Serial.println(flow_xon ? F("flow xon") : F("flow off"));
+        return true;
+    }
+    if ( token_word(t, PSTR("resume")) ) {
+        // resume: go on with the burn of the journal on the SD card
+        if ( !check_writable() )
+            return false;
+        return check_rc(job_resume_start());
+    }
+    if ( token_word(t, PSTR("stats")) ) {
+        // stats [reset | csv [file]]: programming statistics; with a file every f job
+        // appends a row to it, "stats csv" alone stops that
+        if ( token_word(t, PSTR("reset")) )
+            memset(&prog_stats, 0, sizeof(prog_stats));
+        else if ( token_word(t, PSTR("csv")) ) {
+            stats_csv[0] = 0;
+            if ( arg_filename(t, name) == ARG_OK ) {
+                strncpy(stats_csv, name, sizeof(stats_csv) - 1);
+                stats_csv[sizeof(stats_csv) - 1] = 0;
+            }
+        }
+        else if ( !token_end(t) )
+            return syntax_error();
+        else
+            print_stats();
+        return true;
+    }
+    if ( token_word(t, PSTR("gang")) ) {
+        // gang [sockets]: sockets on the gang board, 0 for the single socket
+        switch ( arg_number(t, value) ) {
+            case ARG_OK:
+                if ( value > gang_max_sockets
+                     || (value && (profile.family != FAMILY_27C512 || profile.write != WRITE_PULSE)) )
+                    return syntax_error();
+                gang_sockets = value;
+                gang_socket = 0;
+                gang_select = 1;
+                break;
+            case ARG_BAD:
+                return syntax_error();
+        }
+        if ( !gang_sockets ) {
+            Serial.println(F("single socket"));
+            return true;
+        }
+        Serial.print(gang_sockets);
+        Serial.print(F(" sockets, socket "));
+        Serial.print(gang_socket);
+        Serial.println(F(" selected"));
+        return true;
+    }
+    if ( token_word(t, PSTR("socket")) ) {
+        // socket <n>: socket of the gang board for the single chip commands
+        if ( arg_number(t, value) != ARG_OK || value >= socket_count() )
+            return syntax_error();
+        gang_socket = value;
+        gang_select = 1 << gang_socket;
+        return true;
+    }
+    if ( token_word(t, PSTR("run")) ) {
+        if ( script_running || arg_filename(t, name) != ARG_OK )
+            return syntax_error();
+        return check_rc(run_script(name));
+    }
+    switch ( *t.next++ ) {
+        case 'a':
+        case 'A':
+            switch ( arg_number(t, value) ) {
+                case ARG_OK:
+                    if ( value >= device_size() )
+                        return syntax_error();
+                    nextAdr = adr = value;
+                    break;
+                case ARG_BAD:
+                    return syntax_error();
+            }
+            Serial.print(F("Adresse (hex) = ")); Serial.println(adr, HEX);
+            return true;
+        case 'h':
+        case 'H':
+            Serial.println(adr, HEX);
+            hexDump(F("dump"), buffer, adr, sizeof(buffer));
+            return true;
+        case 'e':
+        case 'E':
+            return job_erase_start();
+        case 'i':
+        {
+            uint16_t id = read_id();
+            Serial.print(F("ID = "));
+            //Serial.println(read_id_new(), HEX);
+            Serial.print(id >> 8, HEX);
+            Serial.print(F(" / "));
+            Serial.println(id & 0xFF, HEX);
+            if ( !eeprom_select_profile(id, true) )
+                Serial.print(F("unknown ID, still "));
+            print_profile();
+            return true;
+        }
+        case 'r':
+            // r [address]
+            switch ( arg_number(t, value) ) {
+                case ARG_OK:
+                    if ( value >= device_size() )
+                        return syntax_error();
+                    adr = value;
+                    break;
+                case ARG_BAD:
+                    return syntax_error();
+            }
+            eeprom_read_bytes_at(adr, buffer, sizeof(buffer));
+            hexDump(F("read"), buffer, adr, sizeof(buffer));
+            nextAdr = adr + sizeof(buffer);
+            return true;
+        case 'n':
+            eeprom_read_bytes_at(nextAdr, buffer, sizeof(buffer));
+            hexDump(F("next read"), buffer, nextAdr, sizeof(buffer));
+            nextAdr += sizeof(buffer);
+            return true;
+        case 'p':
+        {
+            program_result r;
+            if ( !check_writable() )
+                return false;
+            hexDump(F("buffer"), buffer, 0, sizeof(buffer));
+            Serial.print(F("Programming at ")); Serial.println(adr, HEX);
+            if ( program_block(adr, buffer, sizeof(buffer), r) ) {
+                Serial.print(F("programming fails, "));
+                print_program_failures(adr, sizeof(buffer), r);
+                return false;
+            }
+            Serial.print(r.pulses);
+            Serial.print(F(" pulses in "));
+            Serial.print(r.rounds);
+            Serial.println(F(" rounds"));
+            return true;
+        }
+        case 'b':
+            Serial.print(F("Blank check "));
+            if ( gang_sockets )
+                Serial.println();
+            job_begin('b');
+            job_blank_start();
+            return true;
+        case 'f':
+            // f <file>: binary image at the current address, HEX/S-record files at their own
+            if ( arg_filename(t, name) != ARG_OK )
+                return syntax_error();
+            if ( !check_writable() )
+                return false;
+            return check_rc(job_burn_start(name, adr, 0));
+        case 'd':
+            // d <file> [start] [len], default: the whole chip
+            value = 0;
+            if ( arg_filename(t, name) != ARG_OK || arg_number(t, value) == ARG_BAD || value >= device_size() )
+                return syntax_error();
+            len = device_size() - value;
+            if ( arg_length(t, len) == ARG_BAD )
+                return syntax_error();
+            return check_rc(dumpFile(name, value, len));
+        case 'v':
+        {
+            // v <file> [address]
+            value = adr;
+            if ( arg_filename(t, name) != ARG_OK || arg_number(t, value) == ARG_BAD || value >= device_size() )
+                return syntax_error();
+            int32_t rc = verifyFile(name, value);
+            return check_rc(rc) && rc == 0;
+        }
+        case 'x':
+            if ( script_running )
+                return syntax_error();
+            Serial.println(F("binary mode"));
+            binary_mode = true;
+            return true;
+        default:
+            return syntax_error();
+    }
+}
+
+// Run the job a command started to its end, still answering status and abort (see
+// serialEvent()). Returns false if the job failed.
+bool job_wait()
+{
+    if ( !job_running() )
+        return true;
+    while ( job_running() ) {
+        job_step();
+        serialEvent();
+        serial_poll_watermarks();
+    }
+    return job.rc >= 0;
+}
+
+/// run <script>: execute the command lines of a file on the SD card back to back, without
+/// round trips to the host. Every line is echoed with a leading '>'; empty lines and lines
+/// starting with ';' are skipped. The script stops at the first command that fails.
+/// Returns the number of commands executed or -2 open failed, -8 a command failed.
+int32_t run_script(const char *path)
+{
+    char *line = command_line;      // holds the run command, path is a copy of its argument
+    uint8_t n = 0;
+    uint16_t line_no = 0;
+    int32_t executed = 0;
+    bool ok = true;
+    int c;
+
+    File f = SD.open(path);
+    if ( !f )
+        return -2;
+    script_running = true;
+    do {
+        c = f.read();
+        if ( c >= 0 && c != '\n' ) {
+            if ( c != '\r' && n < sizeof(command_line) - 1 )
+                line[n++] = c;
+            continue;
+        }
+        line[n] = 0;
+        line_no++;
+        if ( n && line[0] != ';' ) {
+            Serial.print(F("> "));
+            Serial.println(line);
+            ok = execute_command(line) && job_wait();
+            executed++;
+        }
+        n = 0;
+    } while ( ok && c >= 0 );
+    script_running = false;
+    f.close();
+    if ( !ok ) {
+        Serial.print(F("script stopped in line "));
+        Serial.println(line_no);
+        return -8;
+    }
+    return executed;
+}
+
+// the loop function runs over and over again forever
+void loop()
+{
+    serial_poll_watermarks();
+    if ( binary_mode ) {
+        if ( Serial.available() )
+            binary_command();
+        return;
+    }
+    if ( job_running() ) {
+        job_step();             // queued commands wait for the end of the job
+        return;
+    }
+    // every complete line that arrived, not just one per pass
+    while ( !binary_mode && !job_running() && line_ring_get(console, command_line, sizeof(command_line)) )
+        execute_command(command_line);
+}
+
+
+// status and abort do not wait in the queue behind other commands while a job runs
+void job_control()
+{
+    tokenizer t;
+
+    if ( !line_ring_last(console, command_line, sizeof(command_line)) )
+        return;
+    tokenizer_begin(t, command_line);
+    if ( !token_word(t, PSTR("status")) && !token_word(t, PSTR("abort")) )
+        return;
+    line_ring_drop_last(console);
+    execute_command(command_line);
+}
+
+void serialEvent()
+{
+    char inChar;
+    if (binary_mode)
+        return;
+    if (confirmation_needed) {
+        Serial.flush();
+        if ( Serial.available() ) {
+            inChar = (char)Serial.read();
+        }
+        confirmation_given = (inChar == 'y' || inChar == 'Y');
+        confirmation_needed = false;
+    }
+    else
+        while ( Serial.available() && (line_ring_room(console) || Serial.peek() == '\n') ) {
+            inChar = (char)Serial.read();
+            line_ring_put(console, inChar);
+            if ( inChar == '\n' && job_running() )
+                job_control();
+        }
+}
+
+
+void hexDump(const __FlashStringHelper *desc, void *addr, uint32_t offset, int len)
+{
+    int i;
+    unsigned char ascii_buffer[17]; // ASCII Block
+    char sprintfbuffer[24];
+    unsigned char *pc = (unsigned char *)addr;
+
+    if (len == 0)
+        return;
+    // Output description if given.
+    if (desc != NULL) {
+        Serial.print(desc); Serial.println(F(":"));
+    }
+    // Process every byte in the data.
+    for (i = 0; i < len; i++) {
+        // Multiple of 16 means new line (with line offset).
+
+        if ((i % 16) == 0) {
+            // Just don't print ASCII for the zeroth line.
+            if (i != 0) {
+                Serial.print(F(" | "));
+                Serial.println((char *)ascii_buffer);
+            }
+            // Output the offset.
+            sprintf_P(sprintfbuffer, PSTR("  0x%08lX "), (unsigned long)offset);
+            Serial.print(sprintfbuffer);
+            offset += 16;
+        }
+ 
+        // Now the hex code for the specific character.
+        sprintf_P(sprintfbuffer, PSTR(" %02x"), pc[i]);
+        Serial.print(sprintfbuffer);
+
+        // And store a printable ASCII character for later.
+        if ((pc[i] < 0x20) || (pc[i] > 0x7e))
+            ascii_buffer[i % 16] = '.';
+        else
+            ascii_buffer[i % 16] = pc[i];
+        ascii_buffer[(i % 16) + 1] = '\0';
+    }
+
+    // Pad out last line if not exactly 16 characters.
+    while ((i % 16) != 0) {
+        Serial.print(F("   "));
+        i++;
+    }
+
+    // And print the final ASCII bit.
+    Serial.print(F(" | "));
+    Serial.println((char *)ascii_buffer);
+}
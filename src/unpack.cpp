@@ -0,0 +1,42 @@
+#include <stdint.h>
+
+#include "unpack.h"
+
+int16_t unpack_block(const uint8_t *in, uint16_t in_len, uint8_t *out, uint16_t out_max)
+{
+    const uint8_t *end = in + in_len;
+    uint16_t pos = 0;
+
+    while ( in < end ) {
+        uint8_t c = *in++;
+        uint16_t n;
+        if ( c < 0x80 ) {
+            n = c + 1;
+            if ( n > (uint16_t)(end - in) || n > out_max - pos )
+                return UNPACK_BAD;
+            while ( n-- )
+                out[pos++] = *in++;
+            continue;
+        }
+        if ( in == end )
+            return UNPACK_BAD;
+        if ( c < 0xC0 ) {
+            uint16_t distance = *in++ + 1;
+            n = (c & 0x3F) + 3;
+            if ( distance > pos || n > out_max - pos )
+                return UNPACK_BAD;
+            for ( ; n; n--, pos++ )
+                out[pos] = out[pos - distance];
+        }
+        else if ( c == 0xC0 ) {
+            n = *in++ + 1;
+            if ( n > out_max - pos )
+                return UNPACK_BAD;
+            while ( n-- )
+                out[pos++] = 0xFF;
+        }
+        else
+            return UNPACK_BAD;
+    }
+    return pos;
+}
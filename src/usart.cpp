@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include "HardwareSerial_private.h"
+
+#include "usart.h"
+
+static uint8_t rx_high, rx_low;
+static water_callback on_rx_high, on_rx_low;
+static volatile bool above_high;
+
+// Serial and its vectors as in the core's HardwareSerial0.cpp, which is then never linked. The
+// RX vector also watches the high water mark, so a sender is stopped however long the firmware
+// is busy elsewhere.
+HardwareSerial Serial(&UBRR0H, &UBRR0L, &UCSR0A, &UCSR0B, &UCSR0C, &UDR0);
+
+ISR(USART_RX_vect)
+{
+    Serial._rx_complete_irq();
+    if ( on_rx_high && !above_high && Serial.available() >= rx_high ) {
+        above_high = true;
+        on_rx_high();
+    }
+}
+
+ISR(USART_UDRE_vect)
+{
+    Serial._tx_udr_empty_irq();
+}
+
+// serialEventRun() of the core calls serialEvent() when this says so
+bool Serial0_available()
+{
+    return Serial.available();
+}
+
+uint16_t serial_write_some(const uint8_t *buf, uint16_t len)
+{
+    uint16_t room = Serial.availableForWrite();
+
+    if ( len > room )
+        len = room;
+    for ( uint16_t i = 0; i < len; i++ )
+        Serial.write(buf[i]);
+    return len;
+}
+
+void serial_send_now(uint8_t c)
+{
+    uint8_t sreg = SREG;
+    cli();
+    while ( !(UCSR0A & _BV(UDRE0)) )
+        ;
+    UDR0 = c;
+    UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0);     // clear TXC0 like HardwareSerial::write()
+    SREG = sreg;
+}
+
+void serial_set_watermarks(uint8_t high, uint8_t low, water_callback on_high, water_callback on_low)
+{
+    uint8_t sreg = SREG;
+    cli();
+    rx_high = high;
+    rx_low = low;
+    on_rx_high = on_high;
+    on_rx_low = on_low;
+    above_high = false;
+    SREG = sreg;
+}
+
+void serial_poll_watermarks()
+{
+    if ( above_high && Serial.available() <= rx_low ) {
+        above_high = false;
+        if ( on_rx_low )
+            on_rx_low();
+    }
+}
@@ -0,0 +1,212 @@
+// Unit tests of the command line ring and the argument parsers (src/command.cpp):
+// pio test -e native
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "command.h"
+
+static line_ring ring;
+static char line[command_line_size];
+
+void setUp()
+{
+    memset(&ring, 0, sizeof(ring));
+}
+
+void tearDown()
+{
+}
+
+static bool put(const char *text)
+{
+    for (; *text; text++)
+        if (!line_ring_put(ring, *text))
+            return false;
+    return true;
+}
+
+static void test_lines_in_order()
+{
+    TEST_ASSERT_TRUE(put("first\r\nsecond\n"));
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("first", line);
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("second", line);
+    TEST_ASSERT_FALSE(line_ring_get(ring, line, sizeof(line)));
+}
+
+static void test_backspace()
+{
+    TEST_ASSERT_TRUE(put("\bstatux\bs\n"));
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("status", line);
+}
+
+static void test_partial_line_stays()
+{
+    TEST_ASSERT_TRUE(put("abc"));
+    TEST_ASSERT_FALSE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_TRUE(put("d\n"));
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("abcd", line);
+}
+
+static void test_wraparound()
+{
+    char want[24];
+
+    // 20 character lines: the head passes the end of the 128 byte ring many times
+    for (int i = 0; i < 100; i++) {
+        snprintf(want, sizeof(want), "line %03d abcdefghij", i);
+        TEST_ASSERT_TRUE(put(want));
+        TEST_ASSERT_TRUE(put("\n"));
+        if (i >= 3) {
+            snprintf(want, sizeof(want), "line %03d abcdefghij", i - 3);
+            TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+            TEST_ASSERT_EQUAL_STRING(want, line);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, ring.lines);
+}
+
+static void test_overlong_line()
+{
+    char text[101];
+
+    memset(text, 'x', 100);
+    text[100] = 0;
+    TEST_ASSERT_TRUE(put(text));
+    TEST_ASSERT_TRUE(put("\nok\n"));
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_UINT16(command_line_size - 1, strlen(line));
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("ok", line);
+}
+
+static void test_short_buffer_cuts_the_line()
+{
+    char small[4];
+
+    TEST_ASSERT_TRUE(put("abcdef\nnext\n"));
+    TEST_ASSERT_TRUE(line_ring_get(ring, small, sizeof(small)));
+    TEST_ASSERT_EQUAL_STRING("abc", small);
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("next", line);
+}
+
+static void test_full_ring()
+{
+    // 14 lines of 9 bytes take 126 of the 128 bytes
+    for (int i = 0; i < 14; i++)
+        TEST_ASSERT_TRUE(put("12345678\n"));
+    TEST_ASSERT_TRUE(line_ring_room(ring));
+    TEST_ASSERT_TRUE(put("x"));
+    TEST_ASSERT_FALSE(line_ring_room(ring));
+    TEST_ASSERT_FALSE(line_ring_put(ring, 'y'));
+    TEST_ASSERT_TRUE(line_ring_put(ring, '\n'));       // the terminator still fits
+    TEST_ASSERT_FALSE(line_ring_put(ring, '\n'));
+    TEST_ASSERT_EQUAL_UINT8(15, ring.lines);
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("12345678", line);
+}
+
+static void test_last_line_across_the_wrap()
+{
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(put("0123456789abc\n"));
+        TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    }
+    TEST_ASSERT_TRUE(put("queued\nstatus\npart"));
+    TEST_ASSERT_TRUE(line_ring_last(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("status", line);
+    line_ring_drop_last(ring);
+    TEST_ASSERT_TRUE(put("ial\n"));
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("queued", line);
+    TEST_ASSERT_TRUE(line_ring_get(ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("partial", line);
+    TEST_ASSERT_FALSE(line_ring_last(ring, line, sizeof(line)));
+}
+
+static void test_token_word()
+{
+    char text[] = "  STATUS now";
+    char glued[] = "statusx";
+    tokenizer t;
+
+    tokenizer_begin(t, text);
+    TEST_ASSERT_FALSE(token_word(t, PSTR("stat")));
+    TEST_ASSERT_TRUE(token_word(t, PSTR("status")));
+    TEST_ASSERT_EQUAL_STRING("now", token_next(t));
+    TEST_ASSERT_TRUE(token_end(t));
+    tokenizer_begin(t, glued);
+    TEST_ASSERT_FALSE(token_word(t, PSTR("status")));
+}
+
+static void test_numbers()
+{
+    char text[] = "1f #10 # 1g #";
+    tokenizer t;
+    uint32_t value;
+
+    tokenizer_begin(t, text);
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_number(t, value));
+    TEST_ASSERT_EQUAL_UINT32(0x1F, value);
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_number(t, value));
+    TEST_ASSERT_EQUAL_UINT32(10, value);
+    TEST_ASSERT_EQUAL_INT8(ARG_BAD, arg_number(t, value));
+    TEST_ASSERT_EQUAL_INT8(ARG_BAD, arg_number(t, value));
+    TEST_ASSERT_EQUAL_INT8(ARG_BAD, arg_length(t, value));
+    TEST_ASSERT_EQUAL_INT8(ARG_MISSING, arg_number(t, value));
+}
+
+static void test_lengths()
+{
+    char text[] = "8k 100 #300 0";
+    tokenizer t;
+    uint32_t value;
+
+    tokenizer_begin(t, text);
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_length(t, value));
+    TEST_ASSERT_EQUAL_UINT32(8192, value);
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_length(t, value));
+    TEST_ASSERT_EQUAL_UINT32(0x100, value);
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_length(t, value));
+    TEST_ASSERT_EQUAL_UINT32(300, value);
+    TEST_ASSERT_EQUAL_INT8(ARG_BAD, arg_length(t, value));
+}
+
+static void test_file_names()
+{
+    char text[] = "ABCDEFGH.BIN ABCDEFGHI.BIN A.BINX README";
+    tokenizer t;
+    const char *name;
+
+    tokenizer_begin(t, text);
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_filename(t, name));
+    TEST_ASSERT_EQUAL_STRING("ABCDEFGH.BIN", name);
+    TEST_ASSERT_EQUAL_INT8(ARG_BAD, arg_filename(t, name));
+    TEST_ASSERT_EQUAL_INT8(ARG_BAD, arg_filename(t, name));
+    TEST_ASSERT_EQUAL_INT8(ARG_OK, arg_filename(t, name));
+    TEST_ASSERT_EQUAL_INT8(ARG_MISSING, arg_filename(t, name));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lines_in_order);
+    RUN_TEST(test_backspace);
+    RUN_TEST(test_partial_line_stays);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_overlong_line);
+    RUN_TEST(test_short_buffer_cuts_the_line);
+    RUN_TEST(test_full_ring);
+    RUN_TEST(test_last_line_across_the_wrap);
+    RUN_TEST(test_token_word);
+    RUN_TEST(test_numbers);
+    RUN_TEST(test_lengths);
+    RUN_TEST(test_file_names);
+    return UNITY_END();
+}
@@ -0,0 +1,132 @@
+// Unit tests of the HEX/S-record parser (src/hexfile.cpp): pio test -e native
+
+#include <unity.h>
+
+#include "hexfile.h"
+
+static hex_parser p;
+static uint32_t addresses[16];
+static uint8_t data[16];
+static uint8_t count;           // data bytes handed out by the last feed()
+
+void setUp()
+{
+    hex_begin(p);
+}
+
+void tearDown()
+{
+}
+
+// Feed text up to the first result that is neither HEX_PENDING nor HEX_DATA and return it,
+// HEX_PENDING if the text ends before. The data bytes on the way go to addresses/data.
+static int8_t feed(const char *text)
+{
+    count = 0;
+    for (; *text; text++) {
+        int8_t rc = hex_feed(p, *text);
+        if (rc == HEX_DATA) {
+            if (count < sizeof(data)) {
+                addresses[count] = p.address;
+                data[count] = p.data;
+            }
+            count++;
+        }
+        else if (rc != HEX_PENDING)
+            return rc;
+    }
+    return HEX_PENDING;
+}
+
+static void test_intel_data_record()
+{
+    static const uint8_t want[] = { 0x02, 0x33, 0x7A };
+
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed(":0300300002337A1E"));
+    TEST_ASSERT_EQUAL_UINT8(3, count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(want, data, 3);
+    TEST_ASSERT_EQUAL_HEX32(0x30, addresses[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x32, addresses[2]);
+    TEST_ASSERT_EQUAL_INT8(HEX_END, feed("\r\n:00000001FF\r\n"));
+}
+
+static void test_intel_extended_addresses()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed(":020000040001F9\n"));
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed(":0300300002337A1E\n"));
+    TEST_ASSERT_EQUAL_HEX32(0x10030, addresses[0]);
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed(":020000021200EA\n"));
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed(":0300300002337A1E\n"));
+    TEST_ASSERT_EQUAL_HEX32(0x12030, addresses[0]);
+}
+
+static void test_intel_bad_checksum()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHECKSUM, feed(":0300300002337A1F"));
+}
+
+static void test_intel_bad_characters()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHAR, feed(":03003G0002337A1E"));
+    hex_begin(p);
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHAR, feed("x:0300300002337A1E"));
+}
+
+static void test_intel_truncated_record()
+{
+    // the line ends in the middle of the data, the line break is no hex digit
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHAR, feed(":0300300002\r\n"));
+}
+
+static void test_intel_inconsistent_records()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_RECORD, feed(":00000006FA"));         // unknown type
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_RECORD, feed(":0100000100FE"));       // end of file with data
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_RECORD, feed(":0300000400010000"));   // 3 byte linear address
+}
+
+static void test_line_count()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed(":0300300002337A1E"));
+    TEST_ASSERT_EQUAL_INT8(HEX_PENDING, feed("\r\n\r\n"));
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHECKSUM, feed(":0300300002337A1F"));
+    TEST_ASSERT_EQUAL_UINT16(3, p.line);
+}
+
+static void test_srec_data_records()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed("S00600004844521B\n"));
+    TEST_ASSERT_EQUAL_UINT8(0, count);                          // the header is no data
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed("S1061234010203AD\n"));
+    TEST_ASSERT_EQUAL_UINT8(3, count);
+    TEST_ASSERT_EQUAL_HEX32(0x1234, addresses[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, data[2]);
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed("S205012345AAE7\n"));
+    TEST_ASSERT_EQUAL_HEX32(0x012345, addresses[0]);
+    TEST_ASSERT_EQUAL_INT8(HEX_RECORD, feed("S3070001000055663C\n"));
+    TEST_ASSERT_EQUAL_HEX32(0x00010001, addresses[1]);
+    TEST_ASSERT_EQUAL_INT8(HEX_END, feed("S9030000FC\n"));
+}
+
+static void test_srec_bad_records()
+{
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_RECORD, feed("S4030000FC"));         // no such type
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_RECORD, feed("S1020000"));           // shorter than its address
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHECKSUM, feed("S1061234010203AE"));
+    TEST_ASSERT_EQUAL_INT8(HEX_BAD_CHAR, feed("S10612340102\n"));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_intel_data_record);
+    RUN_TEST(test_intel_extended_addresses);
+    RUN_TEST(test_intel_bad_checksum);
+    RUN_TEST(test_intel_bad_characters);
+    RUN_TEST(test_intel_truncated_record);
+    RUN_TEST(test_intel_inconsistent_records);
+    RUN_TEST(test_line_count);
+    RUN_TEST(test_srec_data_records);
+    RUN_TEST(test_srec_bad_records);
+    return UNITY_END();
+}
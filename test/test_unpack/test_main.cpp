@@ -0,0 +1,117 @@
+// Unit tests of the packed block decoder (src/unpack.cpp): pio test -e native
+
+#include <string.h>
+#include <unity.h>
+
+#include "unpack.h"
+
+static uint8_t out[256];
+
+void setUp()
+{
+    memset(out, 0xA5, sizeof(out));
+}
+
+void tearDown()
+{
+}
+
+static int16_t unpack(const uint8_t *in, uint16_t len, uint16_t out_max = sizeof(out))
+{
+    return unpack_block(in, len, out, out_max);
+}
+
+static void test_literal()
+{
+    static const uint8_t in[] = { 0x02, 'a', 'b', 'c' };
+
+    TEST_ASSERT_EQUAL_INT16(3, unpack(in, sizeof(in)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY("abc", out, 3);
+}
+
+static void test_overlapping_match()
+{
+    // distance 1 repeats the last byte: x, then 4 more
+    static const uint8_t in[] = { 0x00, 'x', 0x81, 0x00 };
+
+    TEST_ASSERT_EQUAL_INT16(5, unpack(in, sizeof(in)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY("xxxxx", out, 5);
+}
+
+static void test_match_back_to_the_start()
+{
+    static const uint8_t in[] = { 0x01, 'a', 'b', 0x80, 0x01 };
+
+    TEST_ASSERT_EQUAL_INT16(5, unpack(in, sizeof(in)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY("ababa", out, 5);
+}
+
+static void test_ff_run()
+{
+    static const uint8_t in[] = { 0xC0, 0xFF };
+
+    TEST_ASSERT_EQUAL_INT16(256, unpack(in, sizeof(in)));
+    TEST_ASSERT_EACH_EQUAL_HEX8(0xFF, out, 256);
+}
+
+static void test_match_before_the_start()
+{
+    static const uint8_t first[] = { 0x80, 0x00 };              // nothing decoded yet
+    static const uint8_t past[] = { 0x00, 'x', 0x80, 0x01 };    // 2 back from 1 byte
+    static const uint8_t far[] = { 0x01, 'a', 'b', 0xBF, 0xFF };
+
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(first, sizeof(first)));
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(past, sizeof(past)));
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(far, sizeof(far)));
+}
+
+static void test_truncated_tokens()
+{
+    static const uint8_t literal[] = { 0x03, 'a', 'b' };
+    static const uint8_t match[] = { 0x00, 'x', 0x81 };
+    static const uint8_t run[] = { 0xC0 };
+
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(literal, sizeof(literal)));
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(match, sizeof(match)));
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(run, sizeof(run)));
+}
+
+static void test_reserved_token()
+{
+    static const uint8_t in[] = { 0x00, 'x', 0xC1, 0x00 };
+
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(in, sizeof(in)));
+}
+
+static void test_output_limit()
+{
+    static const uint8_t literal[] = { 0x02, 'a', 'b', 'c' };
+    static const uint8_t match[] = { 0x00, 'x', 0x81, 0x00 };
+    static const uint8_t run[] = { 0xC0, 0x04 };
+
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(literal, sizeof(literal), 2));
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(match, sizeof(match), 4));
+    TEST_ASSERT_EQUAL_INT16(UNPACK_BAD, unpack(run, sizeof(run), 4));
+    TEST_ASSERT_EQUAL_INT16(5, unpack(run, sizeof(run), 5));
+    TEST_ASSERT_EQUAL_HEX8(0xA5, out[5]);                       // nothing written past the end
+}
+
+static void test_empty_block()
+{
+    TEST_ASSERT_EQUAL_INT16(0, unpack(out, 0));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_literal);
+    RUN_TEST(test_overlapping_match);
+    RUN_TEST(test_match_back_to_the_start);
+    RUN_TEST(test_ff_run);
+    RUN_TEST(test_match_before_the_start);
+    RUN_TEST(test_truncated_tokens);
+    RUN_TEST(test_reserved_token);
+    RUN_TEST(test_output_limit);
+    RUN_TEST(test_empty_block);
+    return UNITY_END();
+}
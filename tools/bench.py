@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Access-pattern benchmark of the firmware hot paths on the host build (see README, Host build).
+
+    bench.py [--program .pio/build/native/program] [--json out.json]
+             [--baseline tools/bench_baseline.json [--tolerance 2]] [--save-baseline FILE]
+
+Every operation runs in a fresh host build process against a generated image; the simulated
+cycles of a run without commands (setup, chip ID, SD init) are subtracted. The result is
+printed as JSON: cycles, simulated time and cycles per byte for each operation. With
+--baseline the run fails (exit 1) if an operation needs more than tolerance percent more
+cycles per byte than the baseline file says. The cycles are those of the register accesses,
+SPI transfers, delays and serial stalls of the simulator; computation is not counted.
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+
+IMAGE_SIZE = 0x8000
+CHIP_SIZE = 0x10000
+
+# name: (commands, bytes, chip contents: None (erased) or "image")
+OPERATIONS = {
+    "blank_check": ("b\n", CHIP_SIZE, None),
+    "hexdump":     ("r 0\n" + "n\n" * 15, 0x1000, "image"),
+    "checksum":    ("checksum 0 10000 crc32\n", CHIP_SIZE, "image"),
+    "sha1":        ("checksum 0 10000 sha1\n", CHIP_SIZE, "image"),
+    "dump":        ("d bench.bin 0 %X\n" % IMAGE_SIZE, IMAGE_SIZE, "image"),
+    "verify":      ("v image.bin\n", IMAGE_SIZE, "image"),
+    "burn":        ("f image.bin\n", IMAGE_SIZE, None),
+    "erase":       ("e\n", CHIP_SIZE, "image"),
+}
+
+COUNTERS = re.compile(r"^total: (.*)$", re.M)
+FAILED = re.compile(r"return code = -|failed", re.I)
+
+
+def run(program, sd, commands, chip_in):
+    """run the host build with commands, returns the counters of the total line"""
+    cmd = shlex.split(program) + ["--sd", sd]
+    if chip_in:
+        cmd += ["--chip-in", chip_in]
+    proc = subprocess.run(cmd, input=commands.encode(), stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE, timeout=600)
+    out = proc.stdout.decode(errors="replace")
+    err = proc.stderr.decode(errors="replace")
+    if proc.returncode != 0:
+        raise RuntimeError("%s exited with %d:\n%s" % (cmd[0], proc.returncode, err))
+    if FAILED.search(out):
+        raise RuntimeError("%r failed:\n%s" % (commands, out))
+    m = COUNTERS.search(err)
+    if not m:
+        raise RuntimeError("no counters from %s:\n%s" % (cmd[0], err))
+    return {k: int(v) for k, v in (f.split("=") for f in m.group(1).split())}
+
+
+def benchmark(program, names):
+    rng = random.Random(27512)
+    image = bytes(rng.randrange(256) for _ in range(IMAGE_SIZE))
+    results = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        sd = os.path.join(tmp, "sd")
+        os.mkdir(sd)
+        with open(os.path.join(sd, "image.bin"), "wb") as f:
+            f.write(image)
+        chip = os.path.join(tmp, "chip.bin")
+        with open(chip, "wb") as f:
+            f.write(image + b"\xff" * (CHIP_SIZE - IMAGE_SIZE))
+
+        idle = run(program, sd, "", None)
+        for name in names:
+            commands, size, contents = OPERATIONS[name]
+            c = run(program, sd, commands, chip if contents == "image" else None)
+            cycles = c["cycles"] - idle["cycles"]
+            results[name] = {
+                "bytes": size,
+                "cycles": cycles,
+                "time_us": c["time_us"] - idle["time_us"],
+                "cycles_per_byte": round(cycles / size, 2),
+                "spi_bytes": c["spi_bytes"] - idle["spi_bytes"],
+                "io": c["io"] - idle["io"],
+            }
+    return results
+
+
+def regressions(results, baseline, tolerance):
+    """operations slower than the baseline by more than tolerance percent"""
+    slower = []
+    for name, r in results.items():
+        if name not in baseline:
+            continue
+        limit = baseline[name]["cycles_per_byte"] * (1 + tolerance / 100.0)
+        if r["cycles_per_byte"] > limit:
+            slower.append("%s: %.2f cycles/byte, baseline %.2f" % (name, r["cycles_per_byte"],
+                                                                    baseline[name]["cycles_per_byte"]))
+    return slower
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program", help="host build to run")
+    parser.add_argument("--json", help="write the results to this file as well")
+    parser.add_argument("--baseline", help="fail if an operation is slower than in this file")
+    parser.add_argument("--tolerance", type=float, default=2.0, help="allowed slowdown in percent")
+    parser.add_argument("--save-baseline", help="write the results as the new baseline")
+    parser.add_argument("operations", nargs="*", help="operations to run, default: all of "
+                        + ", ".join(OPERATIONS))
+    args = parser.parse_args()
+    for name in args.operations:
+        if name not in OPERATIONS:
+            parser.error("unknown operation %s" % name)
+
+    results = benchmark(args.program, args.operations or list(OPERATIONS))
+    text = json.dumps(results, indent=2, sort_keys=True)
+    print(text)
+    for path in (args.json, args.save_baseline):
+        if path:
+            with open(path, "w") as f:
+                f.write(text + "\n")
+    if args.baseline:
+        with open(args.baseline) as f:
+            slower = regressions(results, json.load(f), args.tolerance)
+        for line in slower:
+            sys.stderr.write("slower than baseline: %s\n" % line)
+        if slower:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,321 @@
+#!/usr/bin/env python3
+"""Host side of the binary frame protocol (see include/frame.h).
+
+    eeprog.py --port /dev/ttyUSB0 [--baud 1000000] read out.bin [--start 0] [--length 0x10000]
+    eeprog.py --port /dev/ttyUSB0 [--baud 1000000] write image.bin [--start 0] [--raw]
+
+--exec runs the host build instead of opening a serial port, e.g.
+    eeprog.py --exec ".pio/build/native/program --chip-in chip.bin" read out.bin
+"""
+
+import argparse
+import os
+import select
+import shlex
+import struct
+import subprocess
+import sys
+import time
+
+SOF = 0x7E
+CONSOLE_BAUD = 115200
+
+
+def crc16_xmodem(data, crc=0):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def pack_block(data):
+    """packed block for a PACKED frame (see include/unpack.h); matches stay inside the block"""
+    out = bytearray()
+    literal = bytearray()
+    heads = {}      # 3 byte prefix -> positions it starts at, newest last
+
+    def flush():
+        for i in range(0, len(literal), 128):
+            chunk = literal[i:i + 128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+        del literal[:]
+
+    def remember(pos, end):
+        for j in range(pos, min(end, len(data) - 2)):
+            heads.setdefault(bytes(data[j:j + 3]), []).append(j)
+
+    i = 0
+    while i < len(data):
+        run = 0
+        while i + run < len(data) and run < 256 and data[i + run] == 0xFF:
+            run += 1
+        best, distance = 0, 0
+        for j in reversed(heads.get(bytes(data[i:i + 3]), [])):
+            if i - j > 256:
+                break
+            n = 0
+            while i + n < len(data) and n < 66 and data[j + n] == data[i + n]:
+                n += 1
+            if n > best:
+                best, distance = n, i - j
+        if run >= 3 and run >= best:
+            flush()
+            out += bytes([0xC0, run - 1])
+            step = run
+        elif best >= 3:
+            flush()
+            out += bytes([0x80 | (best - 3), distance - 1])
+            step = best
+        else:
+            literal.append(data[i])
+            step = 1
+        remember(i, i + step)
+        i += step
+    flush()
+    return bytes(out)
+
+
+class SerialLink:
+    def __init__(self, port):
+        import serial  # pyserial
+        self.ser = serial.Serial(port, CONSOLE_BAUD, timeout=0.05)
+        time.sleep(2.0)  # the Nano resets when the port is opened
+
+    def write(self, data):
+        self.ser.write(data)
+
+    def read(self, n, timeout):
+        self.ser.timeout = timeout
+        return self.ser.read(n)
+
+    def set_baud(self, baud):
+        self.ser.flush()
+        self.ser.baudrate = baud
+
+    def close(self):
+        self.ser.close()
+
+
+class ExecLink:
+    """talks to the host build through its stdin/stdout"""
+
+    def __init__(self, command):
+        self.proc = subprocess.Popen(shlex.split(command), stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE)
+
+    def write(self, data):
+        self.proc.stdin.write(data)
+        self.proc.stdin.flush()
+
+    def read(self, n, timeout):
+        out = b""
+        fd = self.proc.stdout.fileno()
+        deadline = time.monotonic() + timeout
+        while len(out) < n:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0 or not select.select([fd], [], [], remaining)[0]:
+                break
+            chunk = os.read(fd, n - len(out))
+            if not chunk:
+                break
+            out += chunk
+        return out
+
+    def set_baud(self, baud):
+        pass
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+class Programmer:
+    def __init__(self, link):
+        self.link = link
+        self.seq = 0
+        self.result = None
+
+    def enter_binary_mode(self):
+        self.link.write(b"\nx\n")
+        seen = b""
+        deadline = time.monotonic() + 5
+        while b"binary mode\r\n" not in seen:
+            if time.monotonic() > deadline:
+                raise IOError("no response from programmer")
+            seen += self.link.read(1, 0.5)
+
+    def send(self, ftype, seq, payload=b""):
+        body = struct.pack("<BBH", ord(ftype), seq, len(payload)) + payload
+        self.link.write(bytes([SOF]) + body + struct.pack("<H", crc16_xmodem(body)))
+
+    def receive(self, timeout=1.0):
+        """returns (type, seq, payload) or None after a timeout or CRC error"""
+        while True:
+            b = self.link.read(1, timeout)
+            if not b:
+                return None
+            if b[0] == SOF:
+                break
+        header = self.link.read(4, timeout)
+        if len(header) != 4:
+            return None
+        ftype, seq, length = struct.unpack("<BBH", header)
+        payload = self.link.read(length, timeout)
+        crc = self.link.read(2, timeout)
+        if len(payload) != length or len(crc) != 2:
+            return None
+        if struct.unpack("<H", crc)[0] != crc16_xmodem(header + payload):
+            return None
+        return chr(ftype), seq, payload
+
+    def command(self, ftype, payload=b"", retries=3):
+        for _ in range(retries):
+            self.seq = (self.seq + 1) & 0xFF
+            self.send(ftype, self.seq, payload)
+            reply = self.receive()
+            if reply and reply[1] == self.seq:
+                if reply[0] == "A":
+                    return
+                if reply[0] == "N":
+                    raise IOError("command %s rejected, error %d" % (ftype, struct.unpack("b", reply[2])[0]))
+        raise IOError("no reply to command %s" % ftype)
+
+    def set_baud(self, baud):
+        self.command("B", struct.pack("<I", baud))
+        self.link.set_baud(baud)
+        time.sleep(0.05)
+        self.command("P")
+
+    @staticmethod
+    def range_args(start, length):
+        """3 byte address and 3 byte length"""
+        return struct.pack("<I", start)[:3] + struct.pack("<I", length)[:3]
+
+    def read(self, start, length, progress=None):
+        self.command("R", self.range_args(start, length))
+        data = bytearray()
+        expected = 0
+        while len(data) < length:
+            frame = self.receive()
+            if frame is None:
+                self.send("N", expected, b"\xff")
+                continue
+            ftype, seq, payload = frame
+            if ftype != "D":
+                raise IOError("unexpected frame %r" % ftype)
+            self.send("A", seq)
+            if seq == expected:
+                data += payload
+                expected = (expected + 1) & 0xFF
+                if progress:
+                    progress(len(data), length)
+        return bytes(data)
+
+    def write(self, start, data, progress=None, block=256, packed=True):
+        """program data at start; blocks are streamed one ahead of the programmer, packed
+        ones as PACKED frames when that is shorter"""
+        self.command("S", self.range_args(start, len(data)))
+        for seq, offset in enumerate(range(0, len(data), block)):
+            chunk = data[offset:offset + block]
+            ftype, payload = "W", chunk
+            if packed:
+                p = pack_block(chunk)
+                if len(p) < len(chunk):
+                    ftype, payload = "Z", p
+            for _ in range(5):
+                self.send(ftype, seq & 0xFF, payload)
+                reply = self.wait_write_reply(seq & 0xFF)
+                if reply == "A":
+                    break
+                if reply == "E":
+                    return self.result
+            else:
+                raise IOError("block %d not accepted" % seq)
+            if progress:
+                progress(offset + len(chunk), len(data))
+        while self.result is None:
+            frame = self.receive(timeout=30.0)
+            if frame is None:
+                raise IOError("no result from programmer")
+            if frame[0] == "E":
+                self.result = struct.unpack("<bI", frame[2] + b"\0")
+        return self.result
+
+    def wait_write_reply(self, seq):
+        """ACK of a WRITE frame arrives after the previous block is programmed"""
+        self.result = None
+        while True:
+            frame = self.receive(timeout=10.0)
+            if frame is None:
+                return None
+            ftype, fseq, payload = frame
+            if ftype == "E":
+                self.result = struct.unpack("<bI", payload + b"\0")
+                return "E"
+            if fseq == seq and ftype in "AN":
+                return ftype
+
+    def quit(self):
+        self.command("Q")
+
+
+def progress(done, total):
+    sys.stderr.write("\r%6d / %d" % (done, total))
+    if done == total:
+        sys.stderr.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    link_group = parser.add_mutually_exclusive_group(required=True)
+    link_group.add_argument("--port", help="serial port of the programmer")
+    link_group.add_argument("--exec", dest="exec_cmd", help="run the host build instead")
+    parser.add_argument("--baud", type=int, default=CONSOLE_BAUD, help="baud rate for the transfer")
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("read", help="read the chip into a file")
+    p.add_argument("file")
+    p.add_argument("--start", type=lambda s: int(s, 0), default=0)
+    p.add_argument("--length", type=lambda s: int(s, 0), default=0x10000)
+    p = sub.add_parser("write", help="program a binary image streamed from the host")
+    p.add_argument("file")
+    p.add_argument("--start", type=lambda s: int(s, 0), default=0)
+    p.add_argument("--raw", action="store_true", help="send the blocks unpacked")
+    args = parser.parse_args()
+
+    link = SerialLink(args.port) if args.port else ExecLink(args.exec_cmd)
+    prog = Programmer(link)
+    try:
+        prog.enter_binary_mode()
+        if args.baud != CONSOLE_BAUD:
+            prog.set_baud(args.baud)
+        if args.command == "read":
+            started = time.monotonic()
+            data = prog.read(args.start, args.length, progress)
+            with open(args.file, "wb") as f:
+                f.write(data)
+            sys.stderr.write("%d bytes in %.2f s\n" % (len(data), time.monotonic() - started))
+        elif args.command == "write":
+            with open(args.file, "rb") as f:
+                data = f.read()
+            started = time.monotonic()
+            rc, written = prog.write(args.start, data, progress, packed=not args.raw)
+            if rc != 0:
+                sys.stderr.write("\n")     # the progress line stopped short
+            sys.stderr.write("%d bytes programmed in %.2f s\n" % (written, time.monotonic() - started))
+            if rc != 0:
+                sys.stderr.write("programming failed, error %d\n" % rc)
+                prog.quit()
+                sys.exit(1)
+        prog.quit()
+    except IOError as e:
+        sys.stderr.write("\n%s\n" % e)
+        sys.exit(1)
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    main()